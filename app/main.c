@@ -47,7 +47,48 @@
 #define GY 80
 
 uint8_t gmem[DF_GSIZE(GY, GX)];
-int     main(void)
+
+#ifdef RASTER_TIMING
+// ============================================================================================
+
+static void _writeNum(struct displayFile *d, uint32_t v)
+
+{
+    char  b[11];
+    char *p = &b[sizeof(b) - 1];
+
+    *p = 0;
+    do {
+        *--p = '0' + v % 10;
+        v /= 10;
+    } while (v);
+
+    DF_writeString(d, p);
+}
+
+// ============================================================================================
+
+static void _showTiming(struct displayFile *d, uint32_t x)
+
+{
+    /* Report the cost of rasterising, which changes as the window moves on and off word boundaries */
+    struct vidRasterTiming t;
+    vidGetRasterTiming(&t);
+
+    DF_gotoXY(d, 2, YSIZE - 1);
+    DF_setToEol(d, ' ');
+    DF_writeString(d, (x & 31) ? "Unaligned x=" : "Aligned x=");
+    _writeNum(d, x);
+    DF_writeString(d, " cyc/line avg ");
+    _writeNum(d, t.lines ? t.total / t.lines : 0);
+    DF_writeString(d, " max ");
+    _writeNum(d, t.max);
+}
+#endif
+
+// ============================================================================================
+
+int main(void)
 
 {
     /* Initialise a screen (This starts output) */
@@ -64,6 +105,8 @@ int     main(void)
     DF_line(d, 0, 0, GX, GY, true);
     DF_line(d, GX, 0, 0, GY, true);
     DF_circle(d, GX / 2, GY / 2, 20, true);
+    DF_drawText(d, &font5x7, 8, 8, "vidout", true);
+    DF_drawText(d, &font4x6, 8, GY - 14, "5x7 and 4x6 fonts", true);
 
     for (uint32_t t = 16; t <= GX - 16; t += 16) {
         DF_line(d, t, 0, t, 5, true);
@@ -106,7 +149,11 @@ int     main(void)
         for (uint32_t t = 0; t < 40000; t++) {
             __asm__("NOP;");
         }
-        DF_setGstart(d, 110, z);
+        /* Graphic windows can sit at any pixel position, so this drifts smoothly in X too */
+        DF_setGstart(d, 96 + z / 4, z);
+#ifdef RASTER_TIMING
+        _showTiming(d, 96 + z / 4);
+#endif
         DF_gotoXY(d, 2, 4);
         DF_setToEol(d, ' ');
         DF_gotoXY(d, 2 + (z / 8) % (XSIZE - 10), 4);
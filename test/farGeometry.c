@@ -0,0 +1,136 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2019 Dave Marples. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host test for drawing with coordinates far outside the graphic window, where the
+ * setup arithmetic is most at risk of overflowing. Each shape is drawn with vertices
+ * near the int16 limits and again with ones that cross the window the same way but
+ * stay close to it, and the two pictures must match.
+ *
+ *   gcc -std=gnu99 -O2 -funsigned-char -I../vidout farGeometry.c ../vidout/displayFile.c \
+ *       ../vidout/gfxFonts.c -o farGeometry && ./farGeometry
+ *
+ * -funsigned-char is needed as the target's char is unsigned.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "displayFile.h"
+
+#define GW    (64)
+#define GH    (64)
+#define FAR   (30000)
+#define NEAR  (1000)
+
+static uint8_t _store[2][DF_SIZE(4, 16)];
+static uint32_t _g[2][GW * GH / 32];
+
+static uint32_t _scratch[DF_POLYSCRATCH(6)];
+
+static int _fails;
+
+/* ========================================================================== */
+
+static struct displayFile *_make(int i)
+
+{
+    struct displayFile *d;
+
+    memset(_g[i], 0, sizeof(_g[i]));
+    d = DF_create(4, 16, _store[i], ' ');
+    DF_appendG(d, GH, GW, _g[i]);
+    return d;
+}
+/* ========================================================================== */
+
+static void _check(const char *name)
+
+{
+    uint32_t set = 0;
+
+    for (uint32_t i = 0; i < GW * GH / 32; i++) {
+        set += __builtin_popcount(_g[0][i]);
+    }
+
+    if ((!set) || (memcmp(_g[0], _g[1], sizeof(_g[0])))) {
+        printf("FAIL %s (%u pixels set)\n", name, set);
+        _fails++;
+    } else {
+        printf("ok   %s\n", name);
+    }
+}
+/* ========================================================================== */
+
+int main(void)
+
+{
+    int32_t s;
+
+    for (int i = 0; i < 2; i++) {
+        s = i ? NEAR : FAR;
+        DF_fillTriangle(_make(i), -s, -s, s, s, -s, s, true);
+    }
+    _check("fillTriangle");
+
+    for (int i = 0; i < 2; i++) {
+        s = i ? NEAR : FAR;
+        DF_drawTriangle(_make(i), -s, -s + 8, s, s + 8, s, -s, true);
+    }
+    _check("drawTriangle");
+
+    for (int i = 0; i < 2; i++) {
+        s = i ? NEAR : FAR;
+        DF_line(_make(i), -s, s + 20, s, -s + 20, true);
+    }
+    _check("line");
+
+    for (int i = 0; i < 2; i++) {
+        s = i ? NEAR : FAR;
+        DF_fillRect(_make(i), -s, 10, 2 * s, 20, true);
+    }
+    _check("fillRect");
+
+    for (uint32_t rule = DF_EVENODD; rule <= DF_NONZERO; rule++) {
+        for (int i = 0; i < 2; i++) {
+            s = i ? NEAR : FAR;
+            struct DF_point p[6] = { { -s, -s }, { s, s }, { s, 48 }, { 16, 48 }, { 16, 56 }, { -s, 56 } };
+            if (DF_fillPolygon(_make(i), p, 6, rule, _scratch, DF_POLYSCRATCH(6), true)) {
+                _fails++;
+            }
+        }
+        _check(rule == DF_EVENODD ? "fillPolygon evenodd" : "fillPolygon nonzero");
+    }
+
+    for (int i = 0; i < 2; i++) {
+        s = i ? NEAR : FAR;
+        struct DF_point p[3] = { { 32 - s, 8 + s }, { 32, 8 }, { 32 + s, 8 + s } };
+        DF_polyline(_make(i), p, 3, true);
+    }
+    _check("polyline");
+
+    return _fails ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2019 Dave Marples. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host golden image test for DF_fillTriangle. Random triangles, on the window, crossing its
+ * edges, far off it and degenerate (flat, single row, collinear, coincident vertices), are
+ * drawn and compared pixel for pixel with a reference model of the coverage rule, which
+ * works out each row directly rather than walking the edges:
+ *
+ *   Every row from the top vertex to the bottom one is filled between the long edge and the
+ *   short edge alongside it, both ends inclusive. The x of an edge at row y is its exact x
+ *   rounded to nearest, halves up. Triangles on one row span all three vertices.
+ *
+ *   gcc -std=gnu99 -O2 -funsigned-char -I../vidout fillTriangle.c ../vidout/displayFile.c \
+ *       ../vidout/gfxFonts.c -o fillTriangle && ./fillTriangle
+ *
+ * -funsigned-char is needed as the target's char is unsigned.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "displayFile.h"
+
+#define GW     (96)
+#define GH     (48)
+#define CASES  (200000)
+
+static uint8_t  _store[DF_SIZE(4, 16)];
+static uint32_t _g[GW * GH / 32];
+static uint8_t  _ref[GH][GW];
+
+static uint32_t _seed = 1;
+
+/* ========================================================================== */
+
+static int32_t _rand(int32_t lo, int32_t hi)
+
+{
+    _seed = _seed * 1103515245 + 12345;
+    return lo + (int32_t)((_seed >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+/* ========================================================================== */
+
+static int64_t _edgeX(int64_t xa, int64_t ya, int64_t xb, int64_t yb, int64_t y)
+
+{
+    /* x of the edge at row y, rounded to nearest with halves up, ie floor(x + 1/2) */
+    int64_t n = 2 * (y - ya) * (xb - xa) + (yb - ya);
+    int64_t d = 2 * (yb - ya);
+    int64_t q = n / d;
+
+    return xa + (((n % d) < 0) ? q - 1 : q);
+}
+
+/* ========================================================================== */
+
+static void _span(int64_t y, int64_t x0, int64_t x1)
+
+{
+    if ((y < 0) || (y >= GH)) { return; }
+    if (x0 > x1) {
+        int64_t t = x0;
+        x0        = x1;
+        x1        = t;
+    }
+    for (int64_t x = (x0 < 0) ? 0 : x0; (x <= x1) && (x < GW); x++) {
+        _ref[y][x] = 1;
+    }
+}
+
+/* ========================================================================== */
+
+static void _model(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+
+{
+    int64_t v[3][2] = { { x0, y0 }, { x1, y1 }, { x2, y2 } };
+
+    memset(_ref, 0, sizeof(_ref));
+
+    /* Order the vertices top to bottom, keeping the order given between ones on the same row */
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2 - i; j++) {
+            if (v[j][1] > v[j + 1][1]) {
+                int64_t t[2] = { v[j][0], v[j][1] };
+                memcpy(v[j], v[j + 1], sizeof(t));
+                memcpy(v[j + 1], t, sizeof(t));
+            }
+        }
+    }
+
+    if (v[0][1] == v[2][1]) {
+        int64_t lo = v[0][0], hi = v[0][0];
+        for (int i = 1; i < 3; i++) {
+            if (v[i][0] < lo) { lo = v[i][0]; }
+            if (v[i][0] > hi) { hi = v[i][0]; }
+        }
+        _span(v[0][1], lo, hi);
+        return;
+    }
+
+    for (int64_t y = (v[0][1] < 0) ? 0 : v[0][1]; (y <= v[2][1]) && (y < GH); y++) {
+        int64_t l = _edgeX(v[0][0], v[0][1], v[2][0], v[2][1], y);
+        int64_t s;
+
+        if (y < v[1][1]) {
+            s = _edgeX(v[0][0], v[0][1], v[1][0], v[1][1], y);
+        } else if (v[1][1] == v[2][1]) {
+            s = v[1][0];
+        } else {
+            s = _edgeX(v[1][0], v[1][1], v[2][0], v[2][1], y);
+        }
+        _span(y, l, s);
+    }
+}
+
+/* ========================================================================== */
+
+static int _compare(struct displayFile *d, bool fg)
+
+{
+    /* Graphic words are in output byte order, so pixel x is bit 7-(x&7) of byte x/8 */
+    const uint8_t *b = (const uint8_t *)DF_getG(d, 0);
+    int            e = 0;
+
+    for (int y = 0; y < GH; y++) {
+        for (int x = 0; x < GW; x++) {
+            int p = (b[y * GW / 8 + x / 8] >> (7 - (x & 7))) & 1;
+            e += (p != (fg ? _ref[y][x] : !_ref[y][x]));
+        }
+    }
+    return e;
+}
+
+/* ========================================================================== */
+
+int main(void)
+
+{
+    int                  fails = 0;
+    struct displayFile * d     = DF_create(4, 16, _store, ' ');
+
+    DF_appendG(d, GH, GW, _g);
+
+    for (int i = 0; i < CASES; i++) {
+        int32_t c[6];
+        int32_t r = (i % 4 == 0) ? 1000000 : (i % 4 == 1) ? 300 : 60;
+
+        for (int k = 0; k < 6; k++) {
+            c[k] = _rand(-r, r) + ((k & 1) ? GH / 2 : GW / 2);
+        }
+
+        /* Make some of them degenerate */
+        switch ((i / 4) % 8) {
+            case 1: c[3] = c[1]; break;                                  /* Flat top or bottom */
+            case 2: c[3] = c[5] = c[1]; break;                           /* All on one row */
+            case 3: c[4] = 2 * c[2] - c[0]; c[5] = 2 * c[3] - c[1]; break; /* Collinear */
+            case 4: c[2] = c[0]; c[3] = c[1]; break;                     /* Two coincident */
+            case 5: c[2] = c[4] = c[0]; c[3] = c[5] = c[1]; break;        /* A single point */
+        }
+
+        bool fg = i & 8;
+        _model(c[0], c[1], c[2], c[3], c[4], c[5]);
+        DF_clearG(d, !fg);
+        DF_fillTriangle(d, c[0], c[1], c[2], c[3], c[4], c[5], fg);
+
+        int e = _compare(d, fg);
+        if (e) {
+            if (fails++ < 10) {
+                printf("FAIL (%d,%d) (%d,%d) (%d,%d) %s: %d pixels differ\n", c[0], c[1], c[2], c[3], c[4], c[5],
+                       fg ? "fg" : "bg", e);
+            }
+        }
+    }
+
+    printf("%d of %d triangles differ from the model\n", fails, CASES);
+    return fails ? 1 : 0;
+}
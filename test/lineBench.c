@@ -0,0 +1,174 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2019 Dave Marples. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host benchmark for DF_line across slope classes, against the per pixel Bresenham it
+ * replaced (a DF_plotG for every pixel). Lines of each class are drawn over and over into a
+ * 320x240 window and the time per line is printed. Each class is also drawn once both ways
+ * into separate windows, which must come out the same.
+ *
+ *   gcc -std=gnu99 -O2 -funsigned-char -I../vidout lineBench.c ../vidout/displayFile.c \
+ *       ../vidout/gfxFonts.c -o lineBench && ./lineBench
+ *
+ * -funsigned-char is needed as the target's char is unsigned.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "displayFile.h"
+
+#define GW    (320)
+#define GH    (240)
+#define LINES (64)
+
+static uint8_t  _store[2][DF_SIZE(4, 16)];
+static uint32_t _g[2][GW * GH / 32];
+
+static uint32_t _seed = 1;
+
+/* ========================================================================== */
+
+static int32_t _rand(int32_t lo, int32_t hi)
+
+{
+    _seed = _seed * 1103515245 + 12345;
+    return lo + (int32_t)((_seed >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+/* ========================================================================== */
+
+static void _oldLine(struct displayFile *d, int32_t h1, int32_t v1, int32_t h2, int32_t v2, bool fg)
+
+{
+    /* The previous DF_line, as it was */
+    int32_t dh, dv, err, e2, sh, sv;
+
+    dh = ((h2 < h1) ? (h1 - h2) : (h2 - h1));
+    dv = ((v2 < v1) ? (v1 - v2) : (v2 - v1));
+
+    sh = (h1 < h2) ? 1 : -1;
+    sv = (v1 < v2) ? 1 : -1;
+
+    err = dh - dv;
+
+    do {
+        DF_plotG(d, h1, v1, fg);
+        e2 = 2 * err;
+        if (e2 > -dv) {
+            err -= dv;
+            h1 += sh;
+        }
+        if (e2 < dh) {
+            err += dh;
+            v1 += sv;
+        }
+    } while ((h1 != h2) || (v1 != v2));
+}
+
+/* ========================================================================== */
+
+static void _draw(struct displayFile *d, const int32_t (*c)[4], bool old, bool fg)
+
+{
+    for (int i = 0; i < LINES; i++) {
+        if (old) {
+            _oldLine(d, c[i][0], c[i][1], c[i][2], c[i][3], fg);
+        } else {
+            DF_line(d, c[i][0], c[i][1], c[i][2], c[i][3], fg);
+        }
+    }
+}
+
+/* ========================================================================== */
+
+static double _time(struct displayFile *d, const int32_t (*c)[4], bool old)
+
+{
+    /* Nanoseconds per line, over enough repeats to take a few tens of milliseconds */
+    struct timespec t0, t1;
+    uint32_t        reps = 0;
+    double          ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    do {
+        _draw(d, c, old, reps & 1);
+        reps++;
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    } while (ns < 5e7);
+
+    return ns / (reps * LINES);
+}
+
+/* ========================================================================== */
+
+int main(void)
+
+{
+    /* Each class is a run of dh by dv, both scaled by up to len and then given random signs */
+    static const struct {
+        const char *name;
+        int32_t     dh, dv;
+    } classes[] = { { "horizontal", 1, 0 }, { "vertical", 0, 1 }, { "shallow 1:8", 8, 1 },
+                    { "shallow 1:3", 3, 1 }, { "45 degree", 1, 1 }, { "steep 3:1", 1, 3 },
+                    { "steep 8:1", 1, 8 } };
+
+    struct displayFile *d[2];
+    int32_t             c[LINES][4];
+    int                 fails = 0;
+
+    for (int i = 0; i < 2; i++) {
+        d[i] = DF_create(4, 16, _store[i], ' ');
+        DF_appendG(d[i], GH, GW, _g[i]);
+    }
+
+    printf("%-12s %10s %10s\n", "lines", "old ns", "new ns");
+    for (uint32_t k = 0; k < sizeof(classes) / sizeof(classes[0]); k++) {
+        for (int i = 0; i < LINES; i++) {
+            int32_t len = _rand(4, 24);
+            c[i][0]     = _rand(0, GW - 1);
+            c[i][1]     = _rand(0, GH - 1);
+            c[i][2]     = c[i][0] + classes[k].dh * len * (_rand(0, 1) ? 1 : -1);
+            c[i][3]     = c[i][1] + classes[k].dv * len * (_rand(0, 1) ? 1 : -1);
+        }
+
+        for (int i = 0; i < 2; i++) {
+            DF_clearG(d[i], false);
+            _draw(d[i], (const int32_t (*)[4])c, i, true);
+        }
+        if (memcmp(_g[0], _g[1], sizeof(_g[0]))) {
+            printf("FAIL %s lines differ\n", classes[k].name);
+            fails++;
+        }
+
+        printf("%-12s %10.0f %10.0f\n", classes[k].name, _time(d[0], (const int32_t (*)[4])c, true),
+               _time(d[0], (const int32_t (*)[4])c, false));
+    }
+
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2019 Dave Marples. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host test for windows and sprites moved part way through a frame. The frame is rasterised
+ * a line at a time as the line interrupt does, and one is moved down the screen before it's
+ * reached. They're taken on from where they were at the start of the frame, so the move
+ * mustn't hold up the ones after it, and it shows at the new place from the next frame.
+ *
+ *   gcc -std=gnu99 -O2 -funsigned-char -Istub -I../vidout midFrame.c ../vidout/rasterLine.c \
+ *       ../vidout/displayFile.c ../vidout/gfxFonts.c -o midFrame && ./midFrame
+ *
+ * -funsigned-char is needed as the target's char is unsigned.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "rasterLine.h"
+#include "font-8x16basic.cinc"
+
+#define WH (16)
+#define WW (32)
+
+static const struct rasterFont *const _fonts[] = { &font };
+
+/* Storage for each displayFile is kept aligned for the struct at its start */
+#define ALIGNED(n) (((n) + 7) & ~7)
+
+static uint8_t  _store[2][ALIGNED(DF_SIZE(YSIZE, XSIZE))] __attribute__((aligned(8)));
+static uint8_t  _lstore[2][ALIGNED(DF_SIZE(0, 0))] __attribute__((aligned(8)));
+static uint32_t _lg[2][WH * WW / 32];
+
+static int _fails;
+
+/* ========================================================================== */
+
+static void _frame(struct displayFile *d, uint32_t at, void (*move)(void), uint32_t *seen)
+
+{
+    /* Rasterise a frame, calling move before line at, and count the lines each window shows on */
+    uint32_t w[XEXTENTB / 4];
+
+    memset(seen, 0, 2 * sizeof(uint32_t));
+    rasterFrame(d, _fonts, 1);
+    for (uint32_t rl = 0; rl < VID_LINES; rl++) {
+        if (rl == at) { move(); }
+        rasterLine(d, _fonts, w, rl);
+        seen[0] += (w[0] != 0);
+        seen[1] += (w[2] != 0);
+    }
+}
+
+/* ========================================================================== */
+
+static void _check(const char *name, const uint32_t *seen, uint32_t a, uint32_t b)
+
+{
+    if ((seen[0] != a) || (seen[1] != b)) {
+        printf("FAIL %s (%u and %u lines shown, expected %u and %u)\n", name, seen[0], seen[1], a, b);
+        _fails++;
+    } else {
+        printf("ok   %s\n", name);
+    }
+}
+
+/* ========================================================================== */
+
+static struct displayFile *_a;
+
+static void _moveA(void) { DF_setGstart(_a, 0, 200); }
+
+static const uint32_t  _bits[8] = { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF,
+                                    0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF };
+static struct DF_sprite _sp[2] = { { .x = 0, .y = 100, .h = 8, .bits = _bits },
+                                   { .x = 64, .y = 110, .h = 8, .bits = _bits } };
+
+static void _moveSprite(void) { _sp[0].y = 250; }
+
+/* ========================================================================== */
+
+int main(void)
+
+{
+    struct displayFile *d = DF_create(YSIZE, XSIZE, _store[0], ' ');
+    struct displayFile *b;
+    uint32_t            seen[2];
+
+    /* Two windows in different columns, a over lines 50 to 65 and b over 60 to 75 */
+    _a = DF_create(0, 0, _lstore[0], 0);
+    b  = DF_create(0, 0, _lstore[1], 0);
+    DF_appendG(_a, WH, WW, _lg[0]);
+    DF_appendG(b, WH, WW, _lg[1]);
+    DF_clearG(_a, true);
+    DF_clearG(b, true);
+    DF_setGstart(_a, 0, 50);
+    DF_setGstart(b, 64, 60);
+    DF_addLayer(d, _a);
+    DF_addLayer(d, b);
+
+    _frame(d, 40, _moveA, seen);
+    _check("layer moved down mid frame", seen, 0, WH);
+    _frame(d, VID_LINES, _moveA, seen);
+    _check("layer after the move", seen, WH, WH);
+
+    /* ...and the same for two sprites, the first over lines 100 to 107 and the second 110 to 117 */
+    d = DF_create(YSIZE, XSIZE, _store[1], ' ');
+    DF_setSprites(d, _sp, 2);
+
+    _frame(d, 90, _moveSprite, seen);
+    _check("sprite moved down mid frame", seen, 0, 8);
+    _frame(d, VID_LINES, _moveSprite, seen);
+    _check("sprite after the move", seen, 8, 8);
+
+    return _fails ? 1 : 0;
+}
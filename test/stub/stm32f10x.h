@@ -0,0 +1,2 @@
+/* Stand-in for the device header so the rasteriser can be built on the host for the tests. */
+/* Nothing from it is used outside vidout.c.                                                */
@@ -0,0 +1,182 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2019 Dave Marples. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host benchmark for DF_fillTriangle, against the x100000 fixed point scheme it replaced
+ * (several divisions a scanline, each span drawn with DF_line). Triangles of a few sizes are
+ * drawn over and over into a 320x240 window and the time per triangle is printed. The host
+ * divides far faster than the M3, so the difference there is larger than shown here.
+ *
+ *   gcc -std=gnu99 -O2 -funsigned-char -I../vidout triangleBench.c ../vidout/displayFile.c \
+ *       ../vidout/gfxFonts.c -o triangleBench && ./triangleBench
+ *
+ * -funsigned-char is needed as the target's char is unsigned.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "displayFile.h"
+
+#define GW     (320)
+#define GH     (240)
+#define SHAPES (64)
+
+static uint8_t  _store[DF_SIZE(4, 16)];
+static uint32_t _g[GW * GH / 32];
+
+static uint32_t _seed = 1;
+
+/* ========================================================================== */
+
+static int32_t _rand(int32_t lo, int32_t hi)
+
+{
+    _seed = _seed * 1103515245 + 12345;
+    return lo + (int32_t)((_seed >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+/* ========================================================================== */
+
+static void _oldFillTriangle(struct displayFile *d, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2,
+                             int32_t y2, bool fg)
+
+{
+    /* The previous DF_fillTriangle, as it was */
+    int z;
+    int dx1, dx2, dx3;
+    int sx1, sx2, sy;
+
+    if (y0 > y1) {
+        z  = y0;
+        y0 = y1;
+        y1 = z;
+        z  = x0;
+        x0 = x1;
+        x1 = z;
+    }
+    if (y1 > y2) {
+        z  = y2;
+        y2 = y1;
+        y1 = z;
+        z  = x2;
+        x2 = x1;
+        x1 = z;
+    }
+    if (y0 > y1) {
+        z  = y1;
+        y1 = y0;
+        y0 = z;
+        z  = x0;
+        x0 = x1;
+        x1 = z;
+    }
+
+    sx2 = x0 * 100000;
+    sx1 = sx2;
+    sy  = y0;
+    dx1 = (y1 - y0 > 0) ? ((x1 - x0) * 100000) / (y1 - y0) : 0;
+    dx2 = (y2 - y0 > 0) ? ((x2 - x0) * 100000) / (y2 - y0) : 0;
+    dx3 = (y2 - y1 > 0) ? ((x2 - x1) * 100000) / (y2 - y1) : 0;
+
+    if (dx1 > dx2) {
+        for (; sy <= y1; sy++, sx1 += dx2, sx2 += dx1) {
+            DF_line(d, sx1 / 100000, sy, sx1 / 100000 + (sx2 - sx1) / 100000, sy, fg);
+        }
+        sx2 = x1 * 100000;
+        sy  = y1;
+        for (; sy < y2; sy++, sx1 += dx2, sx2 += dx3) {
+            DF_line(d, sx1 / 100000, sy, sx1 / 100000 + (sx2 - sx1) / 100000, sy, fg);
+        }
+    } else {
+        for (; sy <= y1; sy++, sx1 += dx1, sx2 += dx2) {
+            DF_line(d, sx1 / 100000, sy, sx1 / 100000 + (sx2 - sx1) / 100000, sy, fg);
+        }
+        sx1 = x1 * 100000;
+        sy  = y1;
+        for (; sy < y2; sy++, sx1 += dx3, sx2 += dx2) {
+            DF_line(d, sx1 / 100000, sy, sx1 / 100000 + (sx2 - sx1) / 100000, sy, fg);
+        }
+    }
+}
+
+/* ========================================================================== */
+
+static double _time(struct displayFile *d, const int32_t (*c)[6], bool old)
+
+{
+    /* Nanoseconds per triangle, over enough repeats to take a few tens of milliseconds */
+    struct timespec t0, t1;
+    uint32_t        reps = 0;
+    double          ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    do {
+        for (int i = 0; i < SHAPES; i++) {
+            if (old) {
+                _oldFillTriangle(d, c[i][0], c[i][1], c[i][2], c[i][3], c[i][4], c[i][5], i & 1);
+            } else {
+                DF_fillTriangle(d, c[i][0], c[i][1], c[i][2], c[i][3], c[i][4], c[i][5], i & 1);
+            }
+        }
+        reps++;
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    } while (ns < 5e7);
+
+    return ns / (reps * SHAPES);
+}
+
+/* ========================================================================== */
+
+int main(void)
+
+{
+    static const struct {
+        const char *name;
+        int32_t     size;
+    } classes[] = { { "small (8px)", 8 }, { "medium (40px)", 40 }, { "large (200px)", 200 }, { "clipped (1000px)", 1000 } };
+
+    struct displayFile *d = DF_create(4, 16, _store, ' ');
+    int32_t             c[SHAPES][6];
+
+    DF_appendG(d, GH, GW, _g);
+
+    printf("%-18s %10s %10s\n", "triangles", "old ns", "new ns");
+    for (uint32_t k = 0; k < sizeof(classes) / sizeof(classes[0]); k++) {
+        for (int i = 0; i < SHAPES; i++) {
+            int32_t cx = _rand(0, GW - 1), cy = _rand(0, GH - 1), s = classes[k].size;
+            for (int v = 0; v < 3; v++) {
+                c[i][v * 2]     = cx + _rand(-s / 2, s / 2);
+                c[i][v * 2 + 1] = cy + _rand(-s / 2, s / 2);
+            }
+        }
+        printf("%-18s %10.0f %10.0f\n", classes[k].name, _time(d, (const int32_t (*)[6])c, true),
+               _time(d, (const int32_t (*)[6])c, false));
+    }
+
+    return 0;
+}
@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+#
+# Software License Agreement (BSD License)
+#
+# Copyright (c) 2019 Dave Marples. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# - Redistributions of source code must retain the above copyright notice,
+#   this list of conditions and the following disclaimer.
+# - Redistributions in binary form must reproduce the above copyright notice,
+#   this list of conditions and the following disclaimer in the documentation
+#   and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+#
+#
+# Convert a PBM or PNG image into the compressed format read by DF_drawImage,
+# written out as a C array to be #included, in the same way as the fonts.
+#
+#   mkimage.py [--invert] [--xor|--no-xor] input.{pbm,png} name > name.cinc
+#
+# For PBM, set bits (black) become lit pixels. For PNG anything lighter than
+# mid grey and not transparent is lit. --invert swaps that around. By default
+# the XOR-with-row-above pass is used only when it makes the image smaller.
+#
+# Only the python standard library is needed (zlib for PNG).
+
+import argparse
+import struct
+import sys
+import zlib
+
+IMGHDRLEN = 5
+IMG_XORROWS = 1 << 0
+IMGMAXWIDTH = 1024
+
+
+def readPBM(data):
+    ''' Returns width, height and rows of 0/1 values with 1 for a set (black) bit '''
+    fields = []
+    pos = 0
+    while len(fields) < 3:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b'#':
+            while data[pos:pos + 1] not in (b'\n', b'\r', b''):
+                pos += 1
+            continue
+        start = pos
+        while not data[pos:pos + 1].isspace():
+            pos += 1
+        fields.append(data[start:pos])
+
+    magic, w, h = fields[0], int(fields[1]), int(fields[2])
+    if magic == b'P4':
+        pos += 1
+        stride = (w + 7) // 8
+        return w, h, [[(data[pos + y * stride + x // 8] >> (7 - x % 8)) & 1 for x in range(w)] for y in range(h)]
+    if magic == b'P1':
+        bits = [c - ord('0') for c in data[pos:] if c in b'01']
+        return w, h, [bits[y * w:(y + 1) * w] for y in range(h)]
+    sys.exit("Not a PBM file")
+
+
+def readPNG(data):
+    ''' Returns width, height and rows of 0/1 values with 1 for a light, opaque pixel '''
+    if data[:8] != b'\x89PNG\r\n\x1a\n':
+        sys.exit("Not a PNG file")
+
+    pos, idat, palette, trns = 8, b'', None, None
+    while pos < len(data):
+        length, ctype = struct.unpack('>I4s', data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if ctype == b'IHDR':
+            w, h, depth, colour, _, _, interlace = struct.unpack('>IIBBBBB', chunk)
+        elif ctype == b'PLTE':
+            palette = [chunk[i:i + 3] for i in range(0, len(chunk), 3)]
+        elif ctype == b'tRNS':
+            trns = chunk
+        elif ctype == b'IDAT':
+            idat += chunk
+        elif ctype == b'IEND':
+            break
+
+    if interlace:
+        sys.exit("Interlaced PNG files are not supported")
+
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[colour]
+    bpp = max(1, channels * depth // 8)
+    stride = (w * channels * depth + 7) // 8
+    raw = zlib.decompress(idat)
+
+    # Undo the per-row filters
+    rows, prev, pos = [], bytearray(stride), 0
+    for y in range(h):
+        ftype, line = raw[pos], bytearray(raw[pos + 1:pos + 1 + stride])
+        pos += 1 + stride
+        for i in range(stride):
+            a = line[i - bpp] if i >= bpp else 0
+            b = prev[i]
+            c = prev[i - bpp] if i >= bpp else 0
+            if ftype == 1:
+                line[i] = (line[i] + a) & 0xff
+            elif ftype == 2:
+                line[i] = (line[i] + b) & 0xff
+            elif ftype == 3:
+                line[i] = (line[i] + (a + b) // 2) & 0xff
+            elif ftype == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                line[i] = (line[i] + (a if pa <= pb and pa <= pc else b if pb <= pc else c)) & 0xff
+        rows.append(line)
+        prev = line
+
+    def samples(line):
+        ''' Samples of a row scaled to 0..255 '''
+        if depth == 16:
+            return [line[i] for i in range(0, len(line), 2)]
+        if depth == 8:
+            return list(line)
+        per = 8 // depth
+        out = [(line[i // per] >> (8 - depth * (i % per + 1))) & ((1 << depth) - 1) for i in range(w * channels)]
+        return out if colour == 3 else [v * 255 // ((1 << depth) - 1) for v in out]
+
+    result = []
+    for line in rows:
+        s = samples(line)
+        out = []
+        for x in range(w):
+            px = s[x * channels:(x + 1) * channels]
+            alpha = 255
+            if colour == 3:
+                idx = px[0]
+                r, g, b = palette[idx]
+                if trns is not None and idx < len(trns):
+                    alpha = trns[idx]
+            elif colour in (0, 4):
+                r = g = b = px[0]
+                if colour == 4:
+                    alpha = px[1]
+            else:
+                r, g, b = px[:3]
+                if colour == 6:
+                    alpha = px[3]
+            out.append(1 if alpha >= 128 and (r * 299 + g * 587 + b * 114) >= 128000 else 0)
+        result.append(out)
+    return w, h, result
+
+
+def packRow(bits):
+    ''' Bytes of a row, MSB is the leftmost pixel '''
+    out = bytearray((len(bits) + 7) // 8)
+    for x, v in enumerate(bits):
+        if v:
+            out[x // 8] |= 0x80 >> (x % 8)
+    return out
+
+
+def packBits(row):
+    ''' PackBits coding of a single row '''
+    out = bytearray()
+    i = 0
+    while i < len(row):
+        run = 1
+        while i + run < len(row) and run < 128 and row[i + run] == row[i]:
+            run += 1
+        if run > 1:
+            out += bytes([(1 - run) & 0xff, row[i]])
+            i += run
+            continue
+        start = i
+        while i < len(row) and i - start < 128:
+            if i + 1 < len(row) and row[i + 1] == row[i]:
+                break
+            i += 1
+        out += bytes([i - start - 1]) + row[start:i]
+    return out
+
+
+def encode(rows, xorRows):
+    data, prev = bytearray(), bytearray(len(rows[0]))
+    for row in rows:
+        data += packBits(bytes(a ^ b for a, b in zip(row, prev)) if xorRows else row)
+        prev = row
+    return data
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert PBM/PNG images for DF_drawImage")
+    parser.add_argument("input", help="PBM (P1/P4) or PNG file")
+    parser.add_argument("name", help="Name of the C array to create")
+    parser.add_argument("--invert", action="store_true", help="Swap lit and unlit pixels")
+    group = parser.add_mutually_exclusive_group()
+    group.add_argument("--xor", dest="xor", action="store_const", const=True, help="Always code rows as XOR with the row above")
+    group.add_argument("--no-xor", dest="xor", action="store_const", const=False, help="Never code rows as XOR with the row above")
+    args = parser.parse_args()
+
+    data = open(args.input, "rb").read()
+    w, h, bits = readPNG(data) if data[:4] == b'\x89PNG' else readPBM(data)
+
+    if not 0 < w <= IMGMAXWIDTH or not 0 < h < 65536:
+        sys.exit("Image is %dx%d, must be at most %d wide" % (w, h, IMGMAXWIDTH))
+
+    rows = [packRow([v ^ args.invert for v in r]) for r in bits]
+    plain, xored = encode(rows, False), encode(rows, True)
+    useXor = args.xor if args.xor is not None else len(xored) < len(plain)
+    body = xored if useXor else plain
+    img = struct.pack('<HHB', w, h, IMG_XORROWS if useXor else 0) + body
+    assert len(img) == IMGHDRLEN + len(body)
+
+    print("/* %s: %dx%d, %d bytes (%d uncompressed)%s, made by mkimage.py */" %
+          (args.input, w, h, len(img), h * len(rows[0]), ", rows XORed" if useXor else ""))
+    print("const uint8_t %s[] = {" % args.name)
+    for i in range(0, len(img), 16):
+        print("    " + ", ".join("0x%02x" % v for v in img[i:i + 16]) + ",")
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
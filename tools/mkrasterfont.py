@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+#
+# Software License Agreement (BSD License)
+#
+# Copyright (c) 2019 Dave Marples. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# - Redistributions of source code must retain the above copyright notice,
+#   this list of conditions and the following disclaimer.
+# - Redistributions in binary form must reproduce the above copyright notice,
+#   this list of conditions and the following disclaimer in the documentation
+#   and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+#
+#
+# Make the shorter fixed pitch fonts for the text rasteriser from the ones
+# already in vidout, written out as C to be #included like font-8x16basic.cinc.
+#
+#   mkrasterfont.py 8x12 > ../vidout/font-8x12.cinc
+#   mkrasterfont.py 8x8  > ../vidout/font-8x8.cinc
+#   mkrasterfont.py 6x8  > ../vidout/font-6x8.cinc
+#   mkrasterfont.py 5x8  > ../vidout/font-5x8.cinc
+#
+# 8x12 is rows 2 to 13 of the 8x16 font, moved down or up by one for the
+# printable characters that have ink above or below that.
+# 8x8 takes the printable characters from the 5x7 font, centred in the cell, and
+# everything else from the 8x16 font with each pair of rows ORed together so
+# that line and block graphics still join up.
+# 6x8 and 5x8 are the narrow fonts, the 5x7 and 4x6 glyphs with a gap column
+# to the right. The rest are the 8x8 ones with columns dropped. Narrow glyphs
+# are held in the top bits of each byte, the rest being left clear.
+
+import os
+import re
+import sys
+
+VIDOUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "vidout")
+
+
+def read8x16():
+    ''' The 256 glyphs of the 8x16 font, 16 row bytes each '''
+    t = open(os.path.join(VIDOUT, "font-8x16basic.cinc")).read()
+    v = [int(x, 16) for x in re.findall(r'0x([0-9a-f]{2}),', t[t.index('.d='):])]
+    return [v[c * 16:(c + 1) * 16] for c in range(256)]
+
+
+def readProp(name):
+    ''' Printable glyphs of a proportional DF_font as {code: (width, rows of 0/1 lists)} '''
+    t = open(os.path.join(VIDOUT, name)).read()
+
+    def array(field):
+        body = t[t.index('.' + field + '='):]
+        body = body[body.index('{') + 1:body.index('}')]
+        return [int(x, 0) for x in re.findall(r'0x[0-9a-f]+|\b\d+\b', re.sub(r'/\*.*?\*/', '', body))]
+
+    height = int(re.search(r'#define \w+_HEIGHT \((\d+)\)', t).group(1))
+    first = ord(re.search(r"\.firstChr='(.)'", t).group(1))
+    widths, offsets, bits = array('width'), array('offset'), array('bits')
+
+    glyphs = {}
+    for i, w in enumerate(widths):
+        rows = [[(bits[(offsets[i] + y * w + x) // 8] >> (7 - (offsets[i] + y * w + x) % 8)) & 1 for x in range(w)]
+                for y in range(height)]
+        glyphs[first + i] = (w, rows)
+    return glyphs
+
+
+def make8x12(g16):
+    out = []
+    for c, g in enumerate(g16):
+        start = 2
+        if 32 <= c < 127:
+            if g[14] and not g[2]:
+                start = 3
+            elif g[1] and not g[13]:
+                start = 1
+        out.append(g[start:start + 12])
+    return out
+
+
+def fromProp(g16, name, cell, x0, y0, keep):
+    ''' 8 row glyphs with the printable ones from a proportional font, placed x0 from the left
+        of a cell glyph pixels wide (centred if narrower) and y0 down, and the rest being the
+        8x16 ones with pairs of rows ORed together and only the columns in keep. '''
+    prop = readProp(name)
+    out = []
+    for c, g in enumerate(g16):
+        if c in prop:
+            w, rows = prop[c]
+            x = x0 + (cell - w) // 2
+            rows = [0] * y0 + [sum(v << (7 - x - i) for i, v in enumerate(r)) for r in rows]
+            out.append(rows + [0] * (8 - len(rows)))
+        else:
+            rows = [g[y * 2] | g[y * 2 + 1] for y in range(8)]
+            out.append([sum(((r >> (7 - k)) & 1) << (7 - i) for i, k in enumerate(keep)) for r in rows])
+    return out
+
+
+def emit(name, width, height, glyphs, note):
+    tag = name.upper()
+    print("/*")
+    print(" * [ This pre-modification version of this file was ]")
+    print(" * [ originally part of the HelenOS project.        ]")
+    print(" *")
+    print(" * Copyright (C) 2005 Martin Decky")
+    print(" * All rights reserved.")
+    print(" *")
+    print(" * Redistribution and use in source and binary forms, with or without")
+    print(" * modification, are permitted provided that the following conditions")
+    print(" * are met:")
+    print(" *")
+    print(" * - Redistributions of source code must retain the above copyright")
+    print(" *   notice, this list of conditions and the following disclaimer.")
+    print(" * - Redistributions in binary form must reproduce the above copyright")
+    print(" *   notice, this list of conditions and the following disclaimer in the")
+    print(" *   documentation and/or other materials provided with the distribution.")
+    print(" * - The name of the author may not be used to endorse or promote products")
+    print(" *   derived from this software without specific prior written permission.")
+    print(" *")
+    print(" * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR")
+    print(" * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES")
+    print(" * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.")
+    print(" * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,")
+    print(" * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT")
+    print(" * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,")
+    print(" * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY")
+    print(" * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT")
+    print(" * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF")
+    print(" * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.")
+    print(" *")
+    print(" *")
+    for l in note:
+        print(" * " + l if l else " *")
+    print(" * Made by tools/mkrasterfont.py, don't edit.")
+    print(" */")
+    print()
+    print("#define %s_HEIGHT (%d)" % (tag, height))
+    print("const struct rasterFont %s =" % name)
+    print()
+    print("{")
+    print("  .height=%s_HEIGHT," % tag)
+    print("  .width=%d," % width)
+    print("  .firstChr=0,")
+    print("  .lastChr=255,")
+    print("  .d=(const uint8_t[])")
+    print("  {")
+    for c, g in enumerate(glyphs):
+        label = "'%s'" % chr(c) if 32 < c < 127 and chr(c) not in "\\'" else ""
+        print("        /* %d 0x%02x %s */" % (c, c, label) if label else "        /* %d 0x%02x */" % (c, c))
+        for v in g:
+            print("        0x%02x, /* %s */" % (v, format(v, "08b")))
+        print()
+    print("  }")
+    print("};")
+
+
+def main():
+    if len(sys.argv) != 2 or sys.argv[1] not in ("8x12", "8x8", "6x8", "5x8"):
+        sys.exit("Usage: mkrasterfont.py 8x12|8x8|6x8|5x8")
+
+    g16 = read8x16()
+    if sys.argv[1] == "8x12":
+        emit("font8x12", 8, 12, make8x12(g16),
+             ["8x12 font for the text rasteriser, rows 2 to 13 of the 8x16 font with",
+              "the printable characters moved to keep their ascenders or descenders."])
+    elif sys.argv[1] == "8x8":
+        emit("font8x8", 8, 8, fromProp(g16, "font-5x7prop.cinc", 5, 1, 0, range(8)),
+             ["8x8 font for the text rasteriser. The printable characters are from the",
+              "5x7 font, the rest are the 8x16 font with pairs of rows ORed together."])
+    elif sys.argv[1] == "6x8":
+        emit("font6x8", 6, 8, fromProp(g16, "font-5x7prop.cinc", 5, 0, 0, (0, 1, 3, 4, 6, 7)),
+             ["Narrow 6x8 font for the text rasteriser, giving about a third more",
+              "columns. The printable characters are from the 5x7 font, the rest are",
+              "the 8x8 ones with two columns dropped."])
+    else:
+        emit("font5x8", 5, 8, fromProp(g16, "font-4x6prop.cinc", 3, 1, 1, (0, 2, 3, 5, 7)),
+             ["Narrow 5x8 font for the text rasteriser, giving 60% more columns. The",
+              "printable characters are from the 4x6 font, the rest are the 8x8 ones",
+              "with three columns dropped."])
+
+
+if __name__ == "__main__":
+    main()
@@ -37,6 +37,27 @@
 #include <string.h>
 #include "displayFile.h"
 
+/* Stores either side of this are made in program order and none are dropped. Tables the */
+/* rasteriser follows from interrupt level are swapped with it, one word store at a time. */
+#define _BARRIER() __asm__ volatile("" ::: "memory")
+
+/* ========================================================================== */
+
+#ifdef GLYPH_CACHE
+static void _cache(struct displayFile *d, uint32_t p, uint32_t n)
+
+{
+    /* Bring the glyph offsets of n characters from p on up to date with the text */
+    while (n--) {
+        d->gc[p] = (uint8_t)d->s[p] * DF_CHARHEIGHT;
+        p++;
+    }
+}
+#define _CACHE(d, p, n) _cache(d, p, n)
+#else
+#define _CACHE(d, p, n)
+#endif
+
 /* ========================================================================== */
 
 struct displayFile *DF_create(uint8_t yres, uint8_t xres, void *s, char c)
@@ -47,8 +68,26 @@ struct displayFile *DF_create(uint8_t yres, uint8_t xres, void *s, char c)
     d->yres = yres;
     d->xres = xres;
     d->s    = s + sizeof(struct displayFile);
+#ifdef GLYPH_CACHE
+    /* A layer has no text and so no cache, and nothing beyond the struct is touched */
+    d->gc = NULL;
+    if ((yres) && (xres)) {
+        d->gc = (uint16_t *)d->s;
+        d->s += (yres * xres + 4) * sizeof(uint16_t);
+        memset(&d->gc[yres * xres], 0, 4 * sizeof(uint16_t));
+    }
+#endif
 
     DF_setScr(d, c);
+    DF_setPattern(d, NULL);
+    d->cset     = NULL;
+    d->a        = NULL;
+    d->cursor   = DF_CURSOR_OFF;
+    d->rowMode  = NULL;
+    d->layer    = NULL;
+    d->g        = NULL;
+    d->sprites  = NULL;
+    d->nsprites = 0;
 
     return d;
 }
@@ -60,6 +99,7 @@ int32_t DF_putChar(struct displayFile *d, uint8_t x, uint8_t y, char c)
 {
     if ((x >= d->xres) || (y >= d->yres)) { return 0; }
     d->s[y * d->xres + x] = c;
+    _CACHE(d, y * d->xres + x, 1);
     return 1;
 }
 
@@ -113,6 +153,7 @@ int32_t DF_writeString(struct displayFile *d, char *s)
             sw++;
         } else {
             d->s[d->yp * d->xres + d->xp] = *sw++;
+            _CACHE(d, d->yp * d->xres + d->xp, 1);
             DF_incX(d);
         }
     }
@@ -130,7 +171,9 @@ int32_t DF_setChar(struct displayFile *d, uint32_t count, char c)
     uint32_t yp      = d->yp;
 
     while ((itCount--) && (yp < d->yres)) {
-        d->s[yp * d->xres + xp++] = c;
+        d->s[yp * d->xres + xp] = c;
+        _CACHE(d, yp * d->xres + xp, 1);
+        xp++;
         DF_incX(d);
     }
 
@@ -142,6 +185,8 @@ int32_t DF_setChar(struct displayFile *d, uint32_t count, char c)
 int32_t DF_setToEol(struct displayFile *d, char c)
 
 {
+    if (d->yp >= d->yres) { return 0; }
+
     int32_t itCount = d->xres - d->xp;
     int32_t ret     = itCount;
 
@@ -150,6 +195,7 @@ int32_t DF_setToEol(struct displayFile *d, char c)
     while (itCount--)
         *f++ = c;
 
+    _CACHE(d, d->yp * d->xres + d->xp, ret);
     return ret;
 }
 
@@ -159,6 +205,7 @@ bool DF_setScr(struct displayFile *d, char c)
 
 {
     memset(d->s, c, d->xres * d->yres);
+    _CACHE(d, 0, d->xres * d->yres);
     d->xp = d->yp = 0;
 
     return true;
@@ -190,6 +237,108 @@ char *DF_getLine(struct displayFile *d, uint8_t yp)
     return &(d->s[yp * d->xres]);
 }
 
+/* ========================================================================== */
+
+int32_t DF_recache(struct displayFile *d, uint8_t yp)
+
+{
+    if (yp >= d->yres) { return -1; }
+
+    _CACHE(d, yp * d->xres, d->xres);
+    return 0;
+}
+
+/* ========================================================================== */
+
+void DF_setCharset(struct displayFile *d, uint8_t *glyphs, uint8_t first, uint32_t count)
+
+{
+    /* Turn the RAM glyphs off while they're changed so the rasteriser doesn't see half of it */
+    d->cset = NULL;
+    _BARRIER();
+    d->csetFirst = first;
+    d->csetCount = (count > 256U - first) ? 256U - first : count;
+    _BARRIER();
+    d->cset = glyphs;
+}
+
+/* ========================================================================== */
+
+int32_t DF_defineChar(struct displayFile *d, uint8_t c, const uint8_t *rows)
+
+{
+    if ((!d->cset) || ((uint32_t)(c - d->csetFirst) >= d->csetCount)) { return -1; }
+
+    memcpy(&d->cset[(c - d->csetFirst) * DF_CHARHEIGHT], rows, DF_CHARHEIGHT);
+    return 0;
+}
+
+/* ========================================================================== */
+
+void DF_setCursor(struct displayFile *d, uint32_t mode) { d->cursor = mode; }
+
+/* ========================================================================== */
+
+void DF_setAttrPlane(struct displayFile *d, uint8_t *a)
+
+{
+    /* Take the plane away while it's cleared, so no line is drawn from a half cleared one */
+    d->a = NULL;
+    _BARRIER();
+    if (a) { memset(a, 0, DF_ASIZE(d->yres, d->xres)); }
+    _BARRIER();
+    d->a = a;
+}
+
+/* ========================================================================== */
+
+int32_t DF_setAttr(struct displayFile *d, uint8_t x, uint8_t y, uint32_t count, uint8_t a)
+
+{
+    if ((!d->a) || (x >= d->xres) || (y >= d->yres)) { return 0; }
+
+    /* Don't run off the end of the screen */
+    uint32_t p = y * d->xres + x;
+    if (count > d->xres * d->yres - p) { count = d->xres * d->yres - p; }
+
+    memset(&d->a[p], a, count);
+    return count;
+}
+
+/* ========================================================================== */
+
+uint8_t *DF_getAttrLine(struct displayFile *d, uint8_t yp)
+
+{
+    if ((!d->a) || (yp >= d->yres)) { return NULL; }
+
+    return &(d->a[yp * d->xres]);
+}
+
+/* ========================================================================== */
+
+void DF_setRowModes(struct displayFile *d, uint8_t *m)
+
+{
+    /* As for the attribute plane, the table is out of use while it's reset */
+    d->rowMode = NULL;
+    _BARRIER();
+    if (m) { memset(m, DF_ROW_NORMAL, d->yres); }
+    _BARRIER();
+    d->rowMode = m;
+}
+
+/* ========================================================================== */
+
+int32_t DF_setRowMode(struct displayFile *d, uint8_t y, uint8_t mode)
+
+{
+    if ((!d->rowMode) || (y >= d->yres)) { return -1; }
+
+    d->rowMode[y] = mode;
+    return 0;
+}
+
 /* ========================================================================== */
 /* ========================================================================== */
 /* ========================================================================== */
@@ -198,6 +347,18 @@ char *DF_getLine(struct displayFile *d, uint8_t yp)
 /* ========================================================================== */
 /* ========================================================================== */
 
+/* Storage of window row y, following the ring offset and any row table */
+static inline uint32_t *_gRow(struct displayFile *d, uint32_t y)
+
+{
+    y += d->gring;
+    if (y >= d->gylen) { y -= d->gylen; }
+
+    return d->grow ? &d->g[d->grow[y]] : &d->g[y * d->gxlenW];
+}
+
+/* ========================================================================== */
+
 int32_t DF_appendG(struct displayFile *d, uint32_t yres, uint32_t xres, void *s)
 
 {
@@ -205,6 +366,11 @@ int32_t DF_appendG(struct displayFile *d, uint32_t yres, uint32_t xres, void *s)
     d->gxlenW = xres >> 5;
     d->gylen  = yres;
     d->g      = s;
+    d->grow   = NULL;
+    d->gring  = 0;
+    d->gcol   = 0;
+    d->gop     = DF_OP_OR;
+    d->gxscale = d->gyscale = 1;
 
     return 0;
 }
@@ -215,6 +381,7 @@ int32_t DF_setGstart(struct displayFile *d, uint32_t x, uint32_t y)
 
 {
     d->gxstartW = x >> 5;
+    d->gxoff    = x & 31;
     d->gystart  = y;
 
     return 0;
@@ -225,9 +392,132 @@ int32_t DF_setGstart(struct displayFile *d, uint32_t x, uint32_t y)
 uint32_t *DF_getG(struct displayFile *d, uint32_t yp)
 
 {
-    if ((NULL == d->g) || (yp < d->gystart) || (yp >= (d->gystart + d->gylen))) return NULL;
+    if ((NULL == d->g) || (yp < d->gystart) || (yp >= (d->gystart + d->gylen * d->gyscale))) return NULL;
+
+    return _gRow(d, (yp - d->gystart) / d->gyscale);
+}
+
+/* ========================================================================== */
+
+int32_t DF_addLayer(struct displayFile *d, struct displayFile *l)
+
+{
+    /* Put the new layer on top of the stack */
+    struct displayFile **p = &d->layer;
+
+    while (*p) {
+        if (*p == l) { return -1; }
+        p = &(*p)->layer;
+    }
+
+    l->layer = NULL;
+    *p       = l;
+    return 0;
+}
+
+/* ========================================================================== */
+
+int32_t DF_removeLayer(struct displayFile *d, struct displayFile *l)
+
+{
+    for (struct displayFile **p = &d->layer; *p; p = &(*p)->layer) {
+        if (*p == l) {
+            *p = l->layer;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/* ========================================================================== */
+
+void DF_setSprites(struct displayFile *d, struct DF_sprite *s, uint32_t n)
+
+{
+    /* Empty the table while it's changed so the frame start never sees a mismatched pair. */
+    /* That runs in the interrupt, so it sees the stores whole and in this order, and the  */
+    /* IRQ needn't be masked.                                                              */
+    d->nsprites = 0;
+    _BARRIER();
+    d->sprites = s;
+    _BARRIER();
+    d->nsprites = n;
+}
+
+/* ========================================================================== */
+
+void DF_setGop(struct displayFile *d, uint32_t op) { d->gop = op; }
+
+/* ========================================================================== */
+
+int32_t DF_setGscale(struct displayFile *d, uint32_t xs, uint32_t ys)
+
+{
+    if (((xs != 1) && (xs != 2) && (xs != 4)) || (!ys)) { return -1; }
+
+    d->gxscale = xs;
+    d->gyscale = ys;
+    return 0;
+}
+
+/* ========================================================================== */
+
+void DF_setGRowTable(struct displayFile *d, uint16_t *t)
+
+{
+    /* As for the row modes, the table is out of use while it's filled */
+    d->grow = NULL;
+    _BARRIER();
+    if (t) {
+        for (uint32_t y = 0; y < d->gylen; y++) {
+            t[y] = y * d->gxlenW;
+        }
+    }
+    _BARRIER();
+    d->grow = t;
+}
+
+/* ========================================================================== */
+
+void DF_scrollG(struct displayFile *d, int32_t n)
+
+{
+    if (!d->gylen) { return; }
+
+    n %= (int32_t)d->gylen;
+    if (n < 0) { n += d->gylen; }
+
+    /* Single store, so the rasteriser sees either the old or the new position */
+    d->gring = (d->gring + n) % d->gylen;
+}
+
+/* ========================================================================== */
+
+void DF_scrollGX(struct displayFile *d, int32_t n)
+
+{
+    int32_t xlen = d->gxlenW << 5;
+
+    if (!xlen) { return; }
+
+    n %= xlen;
+    if (n < 0) { n += xlen; }
+
+    d->gcol = (d->gcol + n) % xlen;
+}
+
+/* ========================================================================== */
+
+uint32_t DF_colG(struct displayFile *d, int32_t x)
+
+{
+    int32_t xlen = d->gxlenW << 5;
 
-    return &d->g[(yp - d->gystart) * d->gxlenW];
+    if (!xlen) { return 0; }
+
+    x = (x + (int32_t)d->gcol) % xlen;
+    return (x < 0) ? x + xlen : x;
 }
 
 /* ========================================================================== */
@@ -236,6 +526,22 @@ uint32_t DF_getGXstartW(struct displayFile *d) { return d->gxstartW; }
 
 /* ========================================================================== */
 
+uint32_t DF_getGXcol(struct displayFile *d) { return d->gcol; }
+
+/* ========================================================================== */
+
+uint32_t DF_getGXoff(struct displayFile *d) { return d->gxoff; }
+
+/* ========================================================================== */
+
+uint32_t DF_getGop(struct displayFile *d) { return d->gop; }
+
+/* ========================================================================== */
+
+uint32_t DF_getGXscale(struct displayFile *d) { return d->gxscale; }
+
+/* ========================================================================== */
+
 uint32_t DF_getGXlenW(struct displayFile *d) { return d->gxlenW; }
 
 /* ========================================================================== */
@@ -254,10 +560,174 @@ uint32_t DF_getGYlen(struct displayFile *d) { return d->gylen; }
 /* ========================================================================== */
 /* ========================================================================== */
 
+/* Graphic words are held in memory in output order, so the leftmost pixel of a word is
+ * the MSB of its first byte. Word wide work is done in screen order (leftmost pixel in
+ * bit 31) and byte swapped on the way in or out of memory, which is a single REV on the M3.
+ */
+#define _SWAP(x) __builtin_bswap32(x)
+
+/* Fill value for row y; the pattern for fg, or its inverse (inv all ones) for background */
+static inline uint32_t _patRow(struct displayFile *d, int32_t y, uint32_t inv) { return d->pat[y & 7] ^ inv; }
+
+/* ========================================================================== */
+
+static inline void _hspanU(struct displayFile *d, int32_t x0, int32_t x1, int32_t y, uint32_t v)
+
+{
+    /* Write v into pixels x0..x1 (inclusive) of row y, a word at a time. No clipping is done */
+    uint32_t *p = _gRow(d, y) + (x0 >> 5);
+    uint32_t  m = 0xFFFFFFFF >> (x0 & 31);
+    int32_t   n = (x1 >> 5) - (x0 >> 5);
+
+    if (n) {
+        *p = (*p & ~_SWAP(m)) | (v & _SWAP(m));
+        p++;
+        while (--n) {
+            *p++ = v;
+        }
+        m = 0xFFFFFFFF;
+    }
+
+    m = _SWAP(m & (0xFFFFFFFF << (31 - (x1 & 31))));
+    *p = (*p & ~m) | (v & m);
+}
+
+/* ========================================================================== */
+
+static inline void _vspanU(struct displayFile *d, int32_t x, int32_t y0, int32_t y1, uint32_t v)
+
+{
+    /* Write v into pixels y0..y1 (inclusive) of column x. Rows needn't be contiguous, so each
+     * one is looked up. No clipping is done.
+     */
+    uint32_t wx = x >> 5;
+    uint32_t m  = _SWAP(0x80000000 >> (x & 31));
+    v &= m;
+
+    for (int32_t y = y0; y <= y1; y++) {
+        uint32_t *p = _gRow(d, y) + wx;
+        *p          = (*p & ~m) | v;
+    }
+}
+
+/* ========================================================================== */
+
+static void _hspan(struct displayFile *d, int32_t x0, int32_t x1, int32_t y, uint32_t v)
+
+{
+    if ((!d->g) || ((uint32_t)y >= d->gylen)) { return; }
+    if (x0 < 0) { x0 = 0; }
+    if (x1 >= (int32_t)(d->gxlenW << 5)) { x1 = (d->gxlenW << 5) - 1; }
+    if (x1 < x0) { return; }
+
+    _hspanU(d, x0, x1, y, v);
+}
+
+/* ========================================================================== */
+
+static void _vspan(struct displayFile *d, int32_t x, int32_t y0, int32_t y1, uint32_t v)
+
+{
+    if ((!d->g) || ((uint32_t)x >= (d->gxlenW << 5))) { return; }
+    if (y0 < 0) { y0 = 0; }
+    if (y1 >= (int32_t)d->gylen) { y1 = d->gylen - 1; }
+    if (y1 < y0) { return; }
+
+    _vspanU(d, x, y0, y1, v);
+}
+
+/* ========================================================================== */
+
+/* An edge being walked down the scanlines. At each row x is the edge position rounded to the
+ * nearest pixel (halves up), held exactly as x + rem/den with q + r/den added per row.
+ */
+struct _edge {
+    int32_t x;
+    int32_t q;
+    int32_t r;
+    int32_t rem;
+    int32_t den;
+};
+
+/* ========================================================================== */
+
+static void _edgeInit(struct _edge *e, int32_t xa, int32_t ya, int32_t xb, int32_t yb, int32_t y)
+
+{
+    /* Set up the edge from (xa,ya) to (xb,yb), where ya < yb, at row y, as the numerator of the
+     * rounded x at that row floor divided by den. Edges on or near the window fit in 32 bits,
+     * but ones from vertices far off it overflow that and go through 64, which is a library
+     * call on the M3 so is kept off the usual path. The walk itself stays in 32, everything it
+     * holds being bounded by the edge's own extent.
+     */
+    int64_t dx = (int64_t)xb - xa;
+    int64_t dy = (int64_t)y - ya;
+
+    e->den = 2 * (yb - ya);
+    if ((dx > -0x4000) && (dx < 0x4000) && (dy < 0x4000) && (e->den < 2 * 0x4000)) {
+        int32_t n = 2 * (int32_t)dy * (int32_t)dx + (yb - ya);
+        e->q      = (2 * (int32_t)dx) / e->den;
+        e->r      = (2 * (int32_t)dx) % e->den;
+        e->x      = n / e->den;
+        e->rem    = n % e->den;
+    } else {
+        int64_t n = 2 * dy * dx + (yb - ya);
+        e->q      = (int32_t)((2 * dx) / e->den);
+        e->r      = (int32_t)((2 * dx) % e->den);
+        e->x      = (int32_t)(n / e->den);
+        e->rem    = (int32_t)(n % e->den);
+    }
+
+    /* ...with the remainders brought into 0..den-1 */
+    if (e->r < 0) {
+        e->r += e->den;
+        e->q--;
+    }
+    if (e->rem < 0) {
+        e->rem += e->den;
+        e->x--;
+    }
+    e->x += xa;
+}
+
+/* ========================================================================== */
+
+static inline void _edgeStep(struct _edge *e)
+
+{
+    e->x += e->q;
+    e->rem += e->r;
+    if (e->rem >= e->den) {
+        e->rem -= e->den;
+        e->x++;
+    }
+}
+
+/* ========================================================================== */
+
+static inline void _pixU(uint32_t *row, int32_t x, uint32_t v)
+
+{
+    /* Write v into pixel x of the row. No clipping is done */
+    uint32_t m = _SWAP(0x80000000 >> (x & 31));
+    row[x >> 5] = (row[x >> 5] & ~m) | (v & m);
+}
+
+/* ========================================================================== */
+
 static void _circleHelper(struct displayFile *d, int32_t x0, int32_t y0, int32_t r, uint8_t cornername, bool fg)
 
 {
-    int32_t f, ddF_x, ddF_y, x, y;
+    int32_t  f, ddF_x, ddF_y, x, y;
+    uint32_t v = fg ? 0xFFFFFFFF : 0;
+
+    /* Nothing to do if it's wholly off the window, and no point need be checked if it's wholly on it */
+    if ((!d->g) || (x0 + r < 0) || (y0 + r < 0) || (x0 - r >= (int32_t)(d->gxlenW << 5)) ||
+        (y0 - r >= (int32_t)d->gylen)) {
+        return;
+    }
+
+    bool inside = (x0 >= r) && (y0 >= r) && (x0 + r < (int32_t)(d->gxlenW << 5)) && (y0 + r < (int32_t)d->gylen);
 
     f     = 1 - r;
     ddF_x = 1;
@@ -274,32 +744,84 @@ static void _circleHelper(struct displayFile *d, int32_t x0, int32_t y0, int32_t
         x++;
         ddF_x += 2;
         f += ddF_x;
-        if (cornername & 0x4) {
-            DF_plotG(d, x0 + x, y0 + y, fg);
-            DF_plotG(d, x0 + y, y0 + x, fg);
-        }
-        if (cornername & 0x2) {
-            DF_plotG(d, x0 + x, y0 - y, fg);
-            DF_plotG(d, x0 + y, y0 - x, fg);
-        }
-        if (cornername & 0x8) {
-            DF_plotG(d, x0 - y, y0 + x, fg);
-            DF_plotG(d, x0 - x, y0 + y, fg);
-        }
-        if (cornername & 0x1) {
-            DF_plotG(d, x0 - y, y0 - x, fg);
-            DF_plotG(d, x0 - x, y0 - y, fg);
+
+        if (inside) {
+            /* The eight symmetric points lie on four rows, so each row is only looked up once */
+            uint32_t *ryp = _gRow(d, y0 + y);
+            uint32_t *rym = _gRow(d, y0 - y);
+            uint32_t *rxp = _gRow(d, y0 + x);
+            uint32_t *rxm = _gRow(d, y0 - x);
+
+            if (cornername & 0x4) {
+                _pixU(ryp, x0 + x, v);
+                _pixU(rxp, x0 + y, v);
+            }
+            if (cornername & 0x2) {
+                _pixU(rym, x0 + x, v);
+                _pixU(rxm, x0 + y, v);
+            }
+            if (cornername & 0x8) {
+                _pixU(rxp, x0 - y, v);
+                _pixU(ryp, x0 - x, v);
+            }
+            if (cornername & 0x1) {
+                _pixU(rxm, x0 - y, v);
+                _pixU(rym, x0 - x, v);
+            }
+        } else {
+            if (cornername & 0x4) {
+                DF_plotG(d, x0 + x, y0 + y, fg);
+                DF_plotG(d, x0 + y, y0 + x, fg);
+            }
+            if (cornername & 0x2) {
+                DF_plotG(d, x0 + x, y0 - y, fg);
+                DF_plotG(d, x0 + y, y0 - x, fg);
+            }
+            if (cornername & 0x8) {
+                DF_plotG(d, x0 - y, y0 + x, fg);
+                DF_plotG(d, x0 - x, y0 + y, fg);
+            }
+            if (cornername & 0x1) {
+                DF_plotG(d, x0 - y, y0 - x, fg);
+                DF_plotG(d, x0 - x, y0 - y, fg);
+            }
         }
     }
 }
 
 /* ========================================================================== */
 
-static void _fillCircleHelper(struct displayFile *d, int32_t x0, int32_t y0, int32_t r, uint8_t cornername, int32_t delta, bool fg)
+static inline void _cornerSpans(struct displayFile *d, int32_t xl, int32_t xr, int32_t yt, int32_t yb, int32_t b,
+                                int32_t w, int32_t r, uint8_t squareEdges, uint32_t inv)
+
+{
+    _hspan(d, xl - ((squareEdges & TOPLEFT) ? r : w), xr + ((squareEdges & TOPRIGHT) ? r : w), yt - b, _patRow(d, yt - b, inv));
+    _hspan(d, xl - ((squareEdges & BOTLEFT) ? r : w), xr + ((squareEdges & BOTRIGHT) ? r : w), yb + b, _patRow(d, yb + b, inv));
+}
+
+/* ========================================================================== */
+
+static void _fillRounded(struct displayFile *d, int32_t xl, int32_t xr, int32_t yt, int32_t yb, int32_t r,
+                         uint8_t squareEdges, uint32_t inv)
 
 {
+    /* Fill a shape with corners of radius r centred on (xl,yt), (xr,yt), (xl,yb) and (xr,yb),
+     * which is a circle when they're all the same point. The midpoint circle walk below
+     * visits each corner row exactly once with its final half width, so every scanline is
+     * written once as a single span.
+     */
     int32_t f, ddF_x, ddF_y, x, y;
 
+    /* Nothing to do if it's wholly off the window, otherwise only the visible middle rows are visited */
+    if ((!d->g) || (xr + r < 0) || (xl - r >= (int32_t)(d->gxlenW << 5)) || (yb + r < 0) ||
+        (yt - r >= (int32_t)d->gylen)) {
+        return;
+    }
+
+    for (int32_t t = (yt < 0) ? 0 : yt; (t <= yb) && (t < (int32_t)d->gylen); t++) {
+        _hspan(d, xl - r, xr + r, t, _patRow(d, t, inv));
+    }
+
     f     = 1 - r;
     ddF_x = 1;
     ddF_y = -2 * r;
@@ -308,6 +830,8 @@ static void _fillCircleHelper(struct displayFile *d, int32_t x0, int32_t y0, int
 
     while (x < y) {
         if (f >= 0) {
+            /* Leaving row y, so x is its final half width */
+            _cornerSpans(d, xl, xr, yt, yb, y, x, r, squareEdges, inv);
             y--;
             ddF_y += 2;
             f += ddF_y;
@@ -316,25 +840,19 @@ static void _fillCircleHelper(struct displayFile *d, int32_t x0, int32_t y0, int
         ddF_x += 2;
         f += ddF_x;
 
-        if (cornername & 0x1) {
-            DF_line(d, x0 + x, y0 - y, x0 + x, y0 - y + 2 * y + 1 + delta, fg);
-            DF_line(d, x0 + y, y0 - x, x0 + y, y0 - x + 2 * x + 1 + delta, fg);
-        }
-        if (cornername & 0x2) {
-            DF_line(d, x0 - x, y0 - y, x0 - x, y0 - y + 2 * y + 1 + delta, fg);
-            DF_line(d, x0 - y, y0 - x, x0 - y, y0 - x + 2 * x + 1 + delta, fg);
-        }
+        /* ...and row x from the other octant is complete with half width y */
+        if (x <= y) { _cornerSpans(d, xl, xr, yt, yb, x, y, r, squareEdges, inv); }
     }
 }
 
 /* ========================================================================== */
 
-uint32_t DF_plotG(struct displayFile *d, uint32_t x, uint32_t y, bool isSet)
+uint32_t DF_plotG(struct displayFile *d, int32_t x, int32_t y, bool isSet)
 
 {
-    if ((!d->g) || (x >= (d->gxlenW << 5)) || (y >= d->gylen)) { return -1; }
+    if ((!d->g) || ((uint32_t)x >= (d->gxlenW << 5)) || ((uint32_t)y >= d->gylen)) { return -1; }
 
-    uint8_t *w = ((uint8_t *)d->g) + (y * (d->gxlenW) << 2) + (x >> 3);
+    uint8_t *w = ((uint8_t *)_gRow(d, y)) + (x >> 3);
     if (isSet) {
         *w |= (0x80 >> (x % 8));
     } else {
@@ -346,10 +864,114 @@ uint32_t DF_plotG(struct displayFile *d, uint32_t x, uint32_t y, bool isSet)
 
 /* ========================================================================== */
 
+static inline uint32_t _outcode(struct displayFile *d, int32_t x, int32_t y)
+
+{
+    /* Cohen-Sutherland region of a point relative to the window */
+    return ((x < 0) ? 1 : 0) | ((x >= (int32_t)(d->gxlenW << 5)) ? 2 : 0) | ((y < 0) ? 4 : 0) |
+           ((y >= (int32_t)d->gylen) ? 8 : 0);
+}
+
+/* ========================================================================== */
+
+static inline int32_t _runStart(int64_t j, int32_t da, int32_t db)
+
+{
+    /* First major axis step of run j of a run-slice line */
+    return j ? (int32_t)(((2 * j - 1) * da) / (2 * db)) + 1 : 0;
+}
+
+/* ========================================================================== */
+
+static void _runSlice(struct displayFile *d, int32_t a1, int32_t b1, int32_t da, int32_t db, int32_t sa, int32_t sb,
+                      int32_t alen, int32_t blen, bool clip, bool horiz, uint32_t v)
+
+{
+    /* Walk a line with major axis a and minor axis b, writing each run along a as a span. Pixel k
+     * (0 <= k < da) sits at a1+sa*k on the major axis and b1+sb*floor((2k*db+da-1)/(2da)) on the
+     * minor one, so run j starts at step floor((2j-1)*da/(2db))+1. When clipping the visible range
+     * of k is found from those directly and the walk starts there, so the pixels drawn are exactly
+     * those the whole line would have drawn, and nothing off the window is visited.
+     */
+    int32_t k0 = 0, k1 = da - 1, j = 0, end, rem, q, r, d2 = 2 * db, lo, hi;
+
+    if (clip) {
+        /* Steps for which the major axis is on the window... */
+        lo = (sa > 0) ? -a1 : a1 - (alen - 1);
+        hi = (sa > 0) ? alen - 1 - a1 : a1;
+        if (lo > k0) { k0 = lo; }
+        if (hi < k1) { k1 = hi; }
+
+        /* ...and the runs for which the minor axis is */
+        lo = (sb > 0) ? -b1 : b1 - (blen - 1);
+        hi = (sb > 0) ? blen - 1 - b1 : b1;
+        if (lo > 0) {
+            lo = _runStart(lo, da, db);
+            if (lo > k0) { k0 = lo; }
+        }
+        hi = _runStart((int64_t)hi + 1, da, db) - 1;
+        if (hi < k1) { k1 = hi; }
+
+        if (k0 > k1) { return; }
+        if (k0) { j = (int32_t)(((int64_t)2 * k0 * db + da - 1) / (2 * (int64_t)da)); }
+    }
+
+    /* First step beyond run j, as a quotient and remainder so it can be advanced without division. */
+    /* Only a clipped start needs 64 bits, which is a library call on the M3, so run 0 avoids it.  */
+    if (!j) {
+        end = da / d2 + 1;
+        rem = da % d2;
+    } else {
+        int64_t n = (2 * (int64_t)j + 1) * da;
+        end       = (int32_t)(n / d2) + 1;
+        rem       = (int32_t)(n % d2);
+    }
+    q = (2 * da) / d2;
+    r = (2 * da) % d2;
+    b1 += sb * j;
+
+    while (k0 <= k1) {
+        hi = (end <= k1) ? end - 1 : k1;
+        lo = (sa > 0) ? a1 + k0 : a1 - hi;
+        hi = (sa > 0) ? a1 + hi : a1 - k0;
+        if (horiz) {
+            _hspanU(d, lo, hi, b1, v);
+        } else {
+            _vspanU(d, b1, lo, hi, v);
+        }
+
+        k0 = end;
+        b1 += sb;
+        end += q;
+        rem += r;
+        if (rem >= d2) {
+            rem -= d2;
+            end++;
+        }
+    }
+}
+
+/* ========================================================================== */
+
 void DF_line(struct displayFile *d, int32_t h1, int32_t v1, int32_t h2, int32_t v2, bool fg)
 
 {
-    int32_t dh, dv, err, e2, sh, sv;
+    /* Lines run from (h1,v1) up to, but not including, (h2,v2). Rather than stepping a pixel at a
+     * time this is a run-slice Bresenham; it steps from one run of pixels on the major axis to the
+     * next, with each run written as a span. Runs are all floor(2*major/(2*minor)) or one more
+     * long, the choice being made by an error term, so there's one division per line and none per run.
+     * The pixels touched are exactly those of the classic per-pixel form.
+     */
+    int32_t  dh, dv, sh, sv;
+    uint32_t oc1, oc2;
+    uint32_t v = fg ? 0xFFFFFFFF : 0;
+
+    if (!d->g) { return; }
+
+    /* Lines entirely to one side of the window can be thrown away straight off */
+    oc1 = _outcode(d, h1, v1);
+    oc2 = _outcode(d, h2, v2);
+    if (oc1 & oc2) { return; }
 
     dh = ((h2 < h1) ? (h1 - h2) : (h2 - h1));
     dv = ((v2 < v1) ? (v1 - v2) : (v2 - v1));
@@ -357,33 +979,39 @@ void DF_line(struct displayFile *d, int32_t h1, int32_t v1, int32_t h2, int32_t
     sh = (h1 < h2) ? 1 : -1;
     sv = (v1 < v2) ? 1 : -1;
 
-    err = dh - dv;
+    /* Horizontal and vertical lines (including single points) go straight to the span writers */
+    if (!dv) {
+        if (dh) { h2 -= sh; }
+        _hspan(d, (sh > 0) ? h1 : h2, (sh > 0) ? h2 : h1, v1, v);
+        return;
+    }
 
-    do {
-        DF_plotG(d, h1, v1, fg);
-        e2 = 2 * err;
-        if (e2 > -dv) {
-            err -= dv;
-            h1 += sh;
-        }
-        if (e2 < dh) {
-            err += dh;
-            v1 += sv;
-        }
-    } while ((h1 != h2) || (v1 != v2));
+    if (!dh) {
+        v2 -= sv;
+        _vspan(d, h1, (sv > 0) ? v1 : v2, (sv > 0) ? v2 : v1, v);
+        return;
+    }
+
+    if (dh >= dv) {
+        /* X major, so horizontal runs */
+        _runSlice(d, h1, v1, dh, dv, sh, sv, d->gxlenW << 5, d->gylen, oc1 | oc2, true, v);
+    } else {
+        /* Y major, so vertical runs */
+        _runSlice(d, v1, h1, dv, dh, sv, sh, d->gylen, d->gxlenW << 5, oc1 | oc2, false, v);
+    }
 }
 
 /* ========================================================================== */
 
-void DF_rect(struct displayFile *d, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t squareEdges, bool fg)
+void DF_rect(struct displayFile *d, int32_t x, int32_t y, int32_t w, int32_t h, uint32_t squareEdges, bool fg)
 
 {
-    DF_roundRect(d, x, y, w, h, TOPLEFT | TOPRIGHT | BOTLEFT | BOTRIGHT | squareEdges, 1, fg);
+    DF_roundRect(d, x, y, w, h, 1, TOPLEFT | TOPRIGHT | BOTLEFT | BOTRIGHT | squareEdges, fg);
 }
 
 /* ========================================================================== */
 
-void DF_roundRect(struct displayFile *d, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t r, uint8_t squareEdges, bool fg)
+void DF_roundRect(struct displayFile *d, int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint8_t squareEdges, bool fg)
 
 {
     if (!(squareEdges & TOPLINE))
@@ -404,52 +1032,58 @@ void DF_roundRect(struct displayFile *d, uint32_t x, uint32_t y, uint32_t w, uin
 
 /* ========================================================================== */
 
-void DF_fillRect(struct displayFile *d, uint32_t x, uint32_t y, uint32_t w, uint32_t h, bool fg)
+void DF_fillRect(struct displayFile *d, int32_t x, int32_t y, int32_t w, int32_t h, bool fg)
 
 {
-    while (h--) {
-        DF_line(d, x, y, x + w, y, fg);
-        y++;
+    /* Clip the rectangle to the window once, then the rows need no further checks */
+    int32_t  x1 = x + w - 1;
+    int32_t  y1 = y + h - 1;
+    uint32_t inv = fg ? 0 : 0xFFFFFFFF;
+
+    if (!d->g) { return; }
+    if (x < 0) { x = 0; }
+    if (y < 0) { y = 0; }
+    if (x1 >= (int32_t)(d->gxlenW << 5)) { x1 = (d->gxlenW << 5) - 1; }
+    if (y1 >= (int32_t)d->gylen) { y1 = d->gylen - 1; }
+    if (x1 < x) { return; }
+
+    for (; y <= y1; y++) {
+        _hspanU(d, x, x1, y, _patRow(d, y, inv));
     }
 }
 
 /* ========================================================================== */
 
-void DF_fillRoundRect(struct displayFile *d, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t r, uint8_t squareEdges, bool fg)
+void DF_fillRoundRect(struct displayFile *d, int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint8_t squareEdges, bool fg)
 
 {
-    DF_fillRect(d, x + r, y, w - 2 * r, h, fg);
-
-    if (squareEdges & TOPLEFT) DF_fillRect(d, x, y, r, r, fg);
-    if (squareEdges & TOPRIGHT) DF_fillRect(d, x + w - r, y, r, r, fg);
-    if (squareEdges & BOTLEFT) DF_fillRect(d, x, y + h - r, r, r, fg);
-    if (squareEdges & BOTRIGHT) DF_fillRect(d, x + w - r, y + h - r, r, r, fg);
-
-    /* draw four corners */
-    _fillCircleHelper(d, x + w - r - 1, y + r, r, 1, h - 2 * r - 1, fg);
-    _fillCircleHelper(d, x + r, y + r, r, 2, h - 2 * r - 1, fg);
+    _fillRounded(d, x + r, x + w - r - 1, y + r, y + h - r - 1, r, squareEdges, fg ? 0 : 0xFFFFFFFF);
 }
 
 /* ========================================================================== */
 
-void DF_fillCircle(struct displayFile *d, uint32_t x0, uint32_t y0, uint32_t r, bool fg)
+void DF_fillCircle(struct displayFile *d, int32_t x0, int32_t y0, int32_t r, bool fg)
 
 {
-    DF_line(d, x0, y0 - r, x0, (y0 - r) + 2 * r + 1, fg);
-    _fillCircleHelper(d, x0, y0, r, 3, 0, fg);
+    _fillRounded(d, x0, x0, y0, y0, r, 0, fg ? 0 : 0xFFFFFFFF);
 }
 
 /* ========================================================================== */
 
-void DF_circle(struct displayFile *d, uint32_t x0, uint32_t y0, uint32_t r, bool fg)
+void DF_circle(struct displayFile *d, int32_t x0, int32_t y0, int32_t r, bool fg)
 
 {
+    /* The octant walk doesn't visit the four points on the axes */
+    DF_plotG(d, x0, y0 - r, fg);
+    DF_plotG(d, x0, y0 + r, fg);
+    DF_plotG(d, x0 - r, y0, fg);
+    DF_plotG(d, x0 + r, y0, fg);
     _circleHelper(d, x0, y0, r, TOPLEFT | TOPRIGHT | BOTLEFT | BOTRIGHT, fg);
 }
 
 /* ========================================================================== */
 
-void DF_drawTriangle(struct displayFile *d, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, bool fg)
+void DF_drawTriangle(struct displayFile *d, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, bool fg)
 
 {
     DF_line(d, x0, y0, x1, y1, fg);
@@ -459,101 +1093,355 @@ void DF_drawTriangle(struct displayFile *d, uint32_t x0, uint32_t y0, uint32_t x
 
 /* ========================================================================== */
 
-void DF_fillTriangle(struct displayFile *d, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, bool fg)
-
-{
-    int z;
-    int dx1, dx2, dx3;     // Interpolation deltas
-    int sx1, sx2, sy;      // Scanline co-ordinates
-
-    if (y0 > y1) {
-        z  = y0;
-        y0 = y1;
-        y1 = z;
-        z  = x0;
-        x0 = x1;
-        x1 = z;
-    }
-    if (y1 > y2) {
-        z  = y2;
-        y2 = y1;
-        y1 = z;
-        z  = x2;
-        x2 = x1;
-        x1 = z;
-    }
-
-    if (y0 > y1) {
-        z  = y1;
-        y1 = y0;
-        y0 = z;
-        z  = x0;
-        x0 = x1;
-        x1 = z;
-    }
-
-    sx2 = (int)x0 * (int)100000;     // Use fixed point math for x axis values
-    sx1 = sx2;
-    sy  = y0;
-    // Calculate interpolation deltas
-    if (y1 - y0 > 0)
-        dx1 = ((x1 - x0) * 100000) / (y1 - y0);
-    else
-        dx1 = 0;
-    if (y2 - y0 > 0)
-        dx2 = ((x2 - x0) * 100000) / (y2 - y0);
-    else
-        dx2 = 0;
-    if (y2 - y1 > 0)
-        dx3 = ((x2 - x1) * 100000) / (y2 - y1);
-    else
-        dx3 = 0;
-
-    // Render scanlines
-    if (dx1 > dx2) {
-        for (; sy <= y1; sy++, sx1 += dx2, sx2 += dx1) {
-            DF_line(d, sx1 / 100000, sy, sx1 / 100000 + (sx2 - sx1) / 100000, sy, fg);
+void DF_fillTriangle(struct displayFile *d, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, bool fg)
+
+{
+    /* Every scanline from the top vertex to the bottom one is filled between the long edge
+     * (v0 to v2) and whichever short edge is alongside, both ends inclusive. Edges are walked
+     * exactly with an integer DDA, so there's no division per scanline, and rows off the top of
+     * the window are skipped by starting the edges at the first visible row.
+     */
+    struct _edge l, s;
+    int32_t      ax = x0, ay = y0, bx = x1, by = y1, cx = x2, cy = y2, t, y, ye;
+    uint32_t     inv = fg ? 0 : 0xFFFFFFFF;
+
+    /* Sort by y so a is the top vertex and c the bottom one */
+    if (ay > by) {
+        t  = ay;
+        ay = by;
+        by = t;
+        t  = ax;
+        ax = bx;
+        bx = t;
+    }
+    if (by > cy) {
+        t  = cy;
+        cy = by;
+        by = t;
+        t  = cx;
+        cx = bx;
+        bx = t;
+    }
+    if (ay > by) {
+        t  = by;
+        by = ay;
+        ay = t;
+        t  = bx;
+        bx = ax;
+        ax = t;
+    }
+
+    if (!d->g) { return; }
+
+    if (ay == cy) {
+        /* Degenerate, all on one line */
+        t = (ax < bx) ? ax : bx;
+        _hspan(d, (t < cx) ? t : cx, (ax > bx) ? ((ax > cx) ? ax : cx) : ((bx > cx) ? bx : cx), ay, _patRow(d, ay, inv));
+        return;
+    }
+
+    y  = (ay < 0) ? 0 : ay;
+    ye = (cy < (int32_t)d->gylen) ? cy : (int32_t)d->gylen - 1;
+    if (y > ye) { return; }
+
+    _edgeInit(&l, ax, ay, cx, cy, y);
+
+    /* Upper part, alongside a-b */
+    if (y < by) {
+        _edgeInit(&s, ax, ay, bx, by, y);
+        for (; (y < by) && (y <= ye); y++) {
+            _hspan(d, (l.x < s.x) ? l.x : s.x, (l.x < s.x) ? s.x : l.x, y, _patRow(d, y, inv));
+            _edgeStep(&l);
+            _edgeStep(&s);
+        }
+    }
+
+    if (y > ye) { return; }
+
+    /* Lower part, alongside b-c (which is flat when b and c share a row) */
+    if (by == cy) {
+        _hspan(d, (l.x < bx) ? l.x : bx, (l.x < bx) ? bx : l.x, y, _patRow(d, y, inv));
+        return;
+    }
+
+    _edgeInit(&s, bx, by, cx, cy, y);
+    for (; y <= ye; y++) {
+        _hspan(d, (l.x < s.x) ? l.x : s.x, (l.x < s.x) ? s.x : l.x, y, _patRow(d, y, inv));
+        _edgeStep(&l);
+        _edgeStep(&s);
+    }
+}
+
+/* ========================================================================== */
+
+void DF_polyline(struct displayFile *d, const struct DF_point *p, uint32_t n, bool fg)
+
+{
+    if (!n) { return; }
+
+    for (uint32_t t = 1; t < n; t++) {
+        DF_line(d, p[t - 1].x, p[t - 1].y, p[t].x, p[t].y, fg);
+    }
+
+    /* Lines stop short of their end point, so finish off the last one */
+    DF_plotG(d, p[n - 1].x, p[n - 1].y, fg);
+}
+
+/* ========================================================================== */
+
+/* Polygon edge, kept in the caller's scratch space */
+struct _polyEdge {
+    struct _edge e;
+    int16_t      ya;  /* Top row */
+    int16_t      yb;  /* Bottom row, which is the first one not covered */
+    int16_t      dir; /* +1 if the polygon runs down this edge, -1 if up */
+};
+
+_Static_assert(sizeof(struct _polyEdge) + sizeof(struct _polyEdge *) <= DF_POLYSCRATCH(1) * sizeof(uint32_t),
+               "DF_POLYSCRATCH too small");
+
+/* ========================================================================== */
+
+int32_t DF_fillPolygon(struct displayFile *d, const struct DF_point *p, uint32_t n, uint32_t rule, uint32_t *scratch,
+                       uint32_t scratchLen, bool fg)
+
+{
+    /* Scanline fill using an edge table. Edges are set up at their first visible row and sorted
+     * by it once, then each row moves the edges starting on it into the active list, drops those
+     * that have ended, sorts the (nearly sorted) active list by x and writes the spans between
+     * crossings. Edges cover rows ya <= y < yb and spans run from the left crossing up to, but not
+     * including, the right one, so polygons sharing an edge tile without overlap and a rectangle
+     * matches DF_fillRect.
+     */
+    struct _polyEdge * edges = (struct _polyEdge *)scratch;
+    struct _polyEdge **act   = (struct _polyEdge **)&edges[n];
+    struct _polyEdge   t;
+    uint32_t           ne = 0, na = 0, next = 0, i, j;
+    int32_t            y, yend, ymin = INT32_MAX, ymax = INT32_MIN;
+    uint32_t           inv = fg ? 0 : 0xFFFFFFFF;
+
+    if (n * (sizeof(struct _polyEdge) + sizeof(struct _polyEdge *)) > scratchLen * sizeof(uint32_t)) { return -1; }
+    if ((!d->g) || (n < 3)) { return 0; }
+
+    /* Build the edge table, ignoring flat edges which never cross a row */
+    for (i = 0; i < n; i++) {
+        const struct DF_point *a = &p[i];
+        const struct DF_point *b = &p[(i + 1 == n) ? 0 : i + 1];
+
+        if (a->y == b->y) { continue; }
+        if (a->y > b->y) {
+            const struct DF_point *s = a;
+            a                        = b;
+            b                        = s;
+            edges[ne].dir            = -1;
+        } else {
+            edges[ne].dir = 1;
+        }
+        edges[ne].ya = a->y;
+        edges[ne].yb = b->y;
+        _edgeInit(&edges[ne].e, a->x, a->y, b->x, b->y, (a->y < 0) ? 0 : a->y);
+        if (a->y < ymin) { ymin = a->y; }
+        if (b->y > ymax) { ymax = b->y; }
+
+        /* Insertion sort by top row as we go */
+        for (j = ne++; (j > 0) && (edges[j - 1].ya > edges[j].ya); j--) {
+            t            = edges[j];
+            edges[j]     = edges[j - 1];
+            edges[j - 1] = t;
         }
-        sx2 = x1 * 100000;
-        sy  = y1;
+    }
+
+    y    = (ymin < 0) ? 0 : ymin;
+    yend = (ymax < (int32_t)d->gylen) ? ymax : (int32_t)d->gylen;
 
-        for (; sy < y2; sy++, sx1 += dx2, sx2 += dx3) {
-            DF_line(d, sx1 / 100000, sy, sx1 / 100000 + (sx2 - sx1) / 100000, sy, fg);
+    for (; y < yend; y++) {
+        /* Pick up edges starting here (or above the window) */
+        while ((next < ne) && (edges[next].ya <= y)) {
+            if (edges[next].yb > y) { act[na++] = &edges[next]; }
+            next++;
         }
-    } else {
-        for (; sy <= y1; sy++, sx1 += dx1, sx2 += dx2) {
-            DF_line(d, sx1 / 100000, sy, sx1 / 100000 + (sx2 - sx1) / 100000, sy, fg);
+
+        /* Drop the ones that have finished, and sort the rest by x */
+        for (i = j = 0; i < na; i++) {
+            if (act[i]->yb > y) {
+                struct _polyEdge *e = act[i];
+                uint32_t          k = j++;
+                for (; (k > 0) && (act[k - 1]->e.x > e->e.x); k--) {
+                    act[k] = act[k - 1];
+                }
+                act[k] = e;
+            }
         }
-        sx1 = x1 * 100000;
-        sy  = y1;
+        na = j;
 
-        for (; sy < y2; sy++, sx1 += dx3, sx2 += dx2) {
-            DF_line(d, sx1 / 100000, sy, sx1 / 100000 + (sx2 - sx1) / 100000, sy, fg);
+        if ((!na) && (next == ne)) { break; }
+
+        if (rule == DF_NONZERO) {
+            int32_t w = 0, x0 = 0;
+            for (i = 0; i < na; i++) {
+                if (!w) { x0 = act[i]->e.x; }
+                w += act[i]->dir;
+                if (!w) { _hspan(d, x0, act[i]->e.x - 1, y, _patRow(d, y, inv)); }
+            }
+        } else {
+            for (i = 0; i + 1 < na; i += 2) {
+                _hspan(d, act[i]->e.x, act[i + 1]->e.x - 1, y, _patRow(d, y, inv));
+            }
+        }
+
+        for (i = 0; i < na; i++) {
+            _edgeStep(&act[i]->e);
         }
     }
+
+    return 0;
 }
 
 /* ========================================================================== */
 
-void DF_clearG(struct displayFile *d, bool fg)
+static int32_t _scanRight(uint32_t *row, int32_t x, int32_t wlen, uint32_t inv)
+
+{
+    /* First column from x rightwards whose pixel, xor'ed with inv, is set (or the window width) */
+    int32_t  wx = x >> 5;
+    uint32_t m  = (_SWAP(row[wx]) ^ inv) & (0xFFFFFFFF >> (x & 31));
+
+    while (!m) {
+        if (++wx >= wlen) { return wlen << 5; }
+        m = _SWAP(row[wx]) ^ inv;
+    }
+
+    return (wx << 5) + __builtin_clz(m);
+}
+
+/* ========================================================================== */
+
+static int32_t _scanLeft(uint32_t *row, int32_t x, uint32_t inv)
+
+{
+    /* First column from x leftwards whose pixel, xor'ed with inv, is set (or -1) */
+    int32_t  wx = x >> 5;
+    uint32_t m  = (_SWAP(row[wx]) ^ inv) & ~(0x7FFFFFFF >> (x & 31));
+
+    while (!m) {
+        if (--wx < 0) { return -1; }
+        m = _SWAP(row[wx]) ^ inv;
+    }
+
+    return (wx << 5) + 31 - __builtin_ctz(m);
+}
+
+/* ========================================================================== */
+
+int32_t DF_floodFill(struct displayFile *d, int32_t x, int32_t y, bool fg, uint32_t *stack, uint32_t stackLen)
 
 {
-    uint32_t *p = d->g;
+    /* Span based flood fill. Each seed popped is grown left and right to the edge of its region,
+     * using whole words to find the boundaries, and filled as one span. The rows above and below
+     * are then scanned across that span and one seed pushed for each run of unfilled pixels.
+     * Seeds live in the caller's stack, one word each, so memory use is bounded; if it fills up
+     * then seeds are dropped, the fill is left incomplete and -1 returned.
+     */
+    uint32_t  inv  = fg ? 0 : 0xFFFFFFFF; /* Makes pixels that aren't to be filled read as set */
+    uint32_t  v    = fg ? 0xFFFFFFFF : 0;
+    uint32_t  sp   = 0;
+    int32_t   wlen = d->gxlenW;
+    int32_t   ret  = 0;
+    int32_t   xl, xr, ny, cx;
+    uint32_t *row;
+
+    if ((!d->g) || ((uint32_t)x >= (d->gxlenW << 5)) || ((uint32_t)y >= d->gylen)) { return 0; }
+    if (!stackLen) { return -1; }
+
+    stack[sp++] = (y << 16) | x;
+
+    while (sp) {
+        y   = stack[--sp] >> 16;
+        x   = stack[sp] & 0xFFFF;
+        row = _gRow(d, y);
+
+        /* May have been filled since it was pushed */
+        if (_scanRight(row, x, wlen, inv) == x) { continue; }
+
+        xl = _scanLeft(row, x, inv) + 1;
+        xr = _scanRight(row, x, wlen, inv) - 1;
+        _hspanU(d, xl, xr, y, v);
+
+        for (ny = y - 1; ny <= y + 1; ny += 2) {
+            if ((uint32_t)ny >= d->gylen) { continue; }
+            row = _gRow(d, ny);
+
+            for (cx = xl; cx <= xr;) {
+                /* Start of the next unfilled run... */
+                cx = _scanRight(row, cx, wlen, ~inv);
+                if (cx > xr) { break; }
+
+                if (sp < stackLen) {
+                    stack[sp++] = (ny << 16) | cx;
+                } else {
+                    ret = -1;
+                }
+
+                /* ...and past its end */
+                cx = _scanRight(row, cx, wlen, inv);
+            }
+        }
+    }
 
+    return ret;
+}
+
+/* ========================================================================== */
+
+/* Gray levels from 0/8 to 8/8 on, taken from an 8x8 Bayer matrix so they're evenly spread */
+const uint8_t DF_grayPattern[DF_GRAYLEVELS][8] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, /* 0/8 */
+    { 0x88, 0x00, 0x22, 0x00, 0x88, 0x00, 0x22, 0x00 }, /* 1/8 */
+    { 0xaa, 0x00, 0xaa, 0x00, 0xaa, 0x00, 0xaa, 0x00 }, /* 2/8 */
+    { 0xaa, 0x44, 0xaa, 0x11, 0xaa, 0x44, 0xaa, 0x11 }, /* 3/8 */
+    { 0xaa, 0x55, 0xaa, 0x55, 0xaa, 0x55, 0xaa, 0x55 }, /* 4/8 */
+    { 0xee, 0x55, 0xbb, 0x55, 0xee, 0x55, 0xbb, 0x55 }, /* 5/8 */
+    { 0xff, 0x55, 0xff, 0x55, 0xff, 0x55, 0xff, 0x55 }, /* 6/8 */
+    { 0xff, 0xdd, 0xff, 0x77, 0xff, 0xdd, 0xff, 0x77 }, /* 7/8 */
+    { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }, /* 8/8 */
+};
+
+/* ========================================================================== */
+
+void DF_setPattern(struct displayFile *d, const uint8_t *pat)
+
+{
+    /* Expand each pattern row across a whole word now, so a patterned span costs the same as
+     * a solid one. Since the pattern repeats every byte it's the same in either byte order,
+     * and lines up with the window horizontally whatever the word.
+     */
+    for (uint32_t t = 0; t < 8; t++) {
+        d->pat[t] = pat ? pat[t] * 0x01010101 : 0xFFFFFFFF;
+    }
+}
+
+/* ========================================================================== */
+
+void DF_clearG(struct displayFile *d, bool fg)
+
+{
     if (!d->g) { return; }
 
-    /* Flush the memory to the default value */
-    for (uint32_t t = 0; t < d->gxlenW * d->gylen; t++) {
-        *p++ = fg ? 0xFFFFFFFF : 0;
+    /* Flush the memory to the default value, a row at a time since rows may be scattered */
+    for (uint32_t y = 0; y < d->gylen; y++) {
+        uint32_t *p = _gRow(d, y);
+        for (uint32_t t = 0; t < d->gxlenW; t++) {
+            *p++ = fg ? 0xFFFFFFFF : 0;
+        }
     }
 }
 
 /* ========================================================================== */
 
-int32_t DF_gotoXYG(struct displayFile *d, uint32_t x, uint32_t y)
+int32_t DF_gotoXYG(struct displayFile *d, int32_t x, int32_t y)
 
 {
-    if ((x < (d->gxlenW << 5)) && (y < d->gylen)) {
+    if (((uint32_t)x < (d->gxlenW << 5)) && ((uint32_t)y < d->gylen)) {
         d->curX = x;
         d->curY = y;
         return 0;
@@ -567,9 +1455,276 @@ int32_t DF_gotoXYG(struct displayFile *d, uint32_t x, uint32_t y)
 int32_t DF_lineTo(struct displayFile *d, int32_t h2, int32_t v2, bool fg)
 
 {
-    if ((h2 < (d->gxlenW << 5)) && (v2 < d->gylen)) { DF_line(d, d->curX, d->curY, h2, v2, fg); }
+    if (((uint32_t)h2 < (d->gxlenW << 5)) && ((uint32_t)v2 < d->gylen)) { DF_line(d, d->curX, d->curY, h2, v2, fg); }
 
     return DF_gotoXYG(d, h2, v2);
 }
 
 /* ========================================================================== */
+/* ========================================================================== */
+/* ========================================================================== */
+/* Text on the graphic surface                                                */
+/* ========================================================================== */
+/* ========================================================================== */
+/* ========================================================================== */
+
+static inline uint32_t _glyphRow(const struct DF_font *f, uint32_t o, uint32_t gw)
+
+{
+    /* Fetch gw bits starting at bit o, returned left justified. Glyphs are at most 8 bits */
+    /* wide and the font carries a guard byte, so two bytes always cover the row.          */
+    uint32_t b = (((uint32_t)f->bits[o >> 3] << 8) | f->bits[(o >> 3) + 1]) << (16 + (o & 7));
+    return b & ~(0xFFFFFFFF >> gw);
+}
+
+/* ========================================================================== */
+
+static inline void _textWord(struct displayFile *d, int32_t y, int32_t wx, uint32_t v, bool fg)
+
+{
+    if ((!v) || ((uint32_t)y >= d->gylen) || ((uint32_t)wx >= d->gxlenW)) { return; }
+
+    uint32_t *p = _gRow(d, y) + wx;
+    if (fg) {
+        *p |= _SWAP(v);
+    } else {
+        *p &= ~_SWAP(v);
+    }
+}
+
+/* ========================================================================== */
+
+int32_t DF_textWidth(const struct DF_font *f, const char *s)
+
+{
+    int32_t width = 0;
+
+    for (; *s; s++) {
+        uint8_t c = *s;
+        if ((c < f->firstChr) || (c > f->lastChr)) { continue; }
+        width += f->width[c - f->firstChr] + (width ? f->spacing : 0);
+    }
+
+    return width;
+}
+
+/* ========================================================================== */
+
+int32_t DF_drawText(struct displayFile *d, const struct DF_font *f, int32_t x, int32_t y, const char *s, bool fg)
+
+{
+    /* Glyph rows are gathered into one accumulator word per font row as the string is walked,
+     * and each accumulator is written out only once it's full (or the string ends). The
+     * string is measured in the same pass.
+     */
+    uint32_t acc[DF_MAXFONTHEIGHT] = { 0 };
+    uint32_t h                     = f->height;
+    int32_t  wx                    = x >> 5; /* Word column the accumulators are destined for */
+    uint32_t bp                    = x & 31; /* Next free bit in the accumulators, from the left */
+    int32_t  width                 = 0;
+
+    if ((!d->g) || (h > DF_MAXFONTHEIGHT)) { return DF_textWidth(f, s); }
+
+    for (; *s; s++) {
+        uint8_t c = *s;
+        if ((c < f->firstChr) || (c > f->lastChr)) { continue; }
+        c -= f->firstChr;
+
+        if (width) {
+            width += f->spacing;
+            bp += f->spacing;
+            if (bp >= 32) {
+                for (uint32_t r = 0; r < h; r++) {
+                    _textWord(d, y + r, wx, acc[r], fg);
+                    acc[r] = 0;
+                }
+                wx++;
+                bp -= 32;
+            }
+        }
+
+        uint32_t gw = f->width[c];
+        uint32_t o  = f->offset[c];
+        width += gw;
+
+        if (bp + gw < 32) {
+            for (uint32_t r = 0; r < h; r++, o += gw) {
+                acc[r] |= _glyphRow(f, o, gw) >> bp;
+            }
+            bp += gw;
+        } else {
+            /* This glyph completes the word, so write it out and carry the remainder */
+            for (uint32_t r = 0; r < h; r++, o += gw) {
+                uint32_t b = _glyphRow(f, o, gw);
+                _textWord(d, y + r, wx, acc[r] | (b >> bp), fg);
+                acc[r] = b << (32 - bp);
+            }
+            wx++;
+            bp = bp + gw - 32;
+        }
+    }
+
+    for (uint32_t r = 0; r < h; r++) {
+        _textWord(d, y + r, wx, acc[r], fg);
+    }
+
+    return width;
+}
+
+/* ========================================================================== */
+
+/* Ordered dither thresholds, an 8x8 Bayer matrix spread over 2..254 so 0 is always off and 255 always on */
+static const uint8_t _bayer[8][8] = {
+    {   2, 130,  34, 162,  10, 138,  42, 170 },
+    { 194,  66, 226,  98, 202,  74, 234, 106 },
+    {  50, 178,  18, 146,  58, 186,  26, 154 },
+    { 242, 114, 210,  82, 250, 122, 218,  90 },
+    {  14, 142,  46, 174,   6, 134,  38, 166 },
+    { 206,  78, 238, 110, 198,  70, 230, 102 },
+    {  62, 190,  30, 158,  54, 182,  22, 150 },
+    { 254, 126, 222,  94, 246, 118, 214,  86 },
+};
+
+/* ========================================================================== */
+
+static inline void _putMasked(uint32_t *row, int32_t wx, int32_t wlen, uint32_t acc, uint32_t m)
+
+{
+    if ((uint32_t)wx < (uint32_t)wlen) {
+        m       = _SWAP(m);
+        row[wx] = (row[wx] & ~m) | (_SWAP(acc) & m);
+    }
+}
+
+/* ========================================================================== */
+
+void DF_ditherRow(struct displayFile *d, const uint8_t *src, uint32_t w, int32_t x, int32_t y, uint32_t scale)
+
+{
+    /* Each output row is built up a bit at a time in a register by comparing against the
+     * threshold for that pixel, and stored a word (32 pixels) at a time. Scaling repeats
+     * each source pixel scale times across and the row scale times down, with the thresholds
+     * carrying on across the copies so the enlarged pixels are dithered too.
+     */
+    if ((!d->g) || (!scale)) { return; }
+
+    for (uint32_t r = 0; r < scale; r++, y++) {
+        if ((uint32_t)y >= d->gylen) { continue; }
+
+        const uint8_t *t   = _bayer[y & 7];
+        uint32_t *     row = _gRow(d, y);
+        int32_t        ox  = x;
+        int32_t        wx  = x >> 5;
+        uint32_t       m   = 0xFFFFFFFF >> (x & 31); /* Pixels of the current word that are ours */
+        uint32_t       acc = 0;
+
+        for (uint32_t i = 0; i < w; i++) {
+            uint8_t p = src[i];
+            for (uint32_t s = 0; s < scale; s++) {
+                acc = (acc << 1) | (p > t[ox & 7]);
+                if (!(++ox & 31)) {
+                    _putMasked(row, wx++, d->gxlenW, acc, m);
+                    m = 0xFFFFFFFF;
+                }
+            }
+        }
+
+        /* Anything left is left justified into a final partial word */
+        if (ox & 31) { _putMasked(row, wx, d->gxlenW, acc << (32 - (ox & 31)), m & ~(0xFFFFFFFF >> (ox & 31))); }
+    }
+}
+
+/* ========================================================================== */
+
+void DF_ditherImage(struct displayFile *d, const uint8_t *src, uint32_t w, uint32_t h, uint32_t stride, int32_t x,
+                    int32_t y, uint32_t scale)
+
+{
+    for (uint32_t r = 0; r < h; r++) {
+        DF_ditherRow(d, &src[r * stride], w, x, y + r * scale, scale);
+    }
+}
+
+/* ========================================================================== */
+/* ========================================================================== */
+
+static void _blitRow(uint32_t *row, int32_t wlen, int32_t x, const uint32_t *src, uint32_t w)
+
+{
+    /* Shift-merge w pixels held in output byte order into the row at pixel x */
+    int32_t  sh    = x & 31;
+    int32_t  wx    = x >> 5;
+    int32_t  last  = (x + (int32_t)w - 1) >> 5;
+    uint32_t lastM = 0xFFFFFFFF << (31 - ((x + w - 1) & 31));
+    uint32_t nw    = (w + 31) / 32;
+    uint32_t carry = 0;
+    uint32_t m     = 0xFFFFFFFF >> sh;
+
+    for (uint32_t i = 0; wx <= last; i++, wx++) {
+        uint32_t s = (i < nw) ? _SWAP(src[i]) : 0;
+        uint32_t v = carry | (s >> sh);
+        carry      = sh ? s << (32 - sh) : 0;
+
+        _putMasked(row, wx, wlen, v, (wx == last) ? m & lastM : m);
+        m = 0xFFFFFFFF;
+    }
+}
+
+/* ========================================================================== */
+
+int32_t DF_drawImage(struct displayFile *d, const uint8_t *img, int32_t x, int32_t y)
+
+{
+    /* Each row is PackBits coded on its own, optionally as the XOR with the row above, and
+     * decoded into a row buffer which is then merged into the window. With XOR coding the
+     * buffer already holds the previous row, so zero runs cost nothing to decode.
+     */
+    uint32_t       rowBuf[DF_IMGMAXWIDTH / 32];
+    uint8_t *      b       = (uint8_t *)rowBuf;
+    uint32_t       w       = img[0] | (img[1] << 8);
+    uint32_t       h       = img[2] | (img[3] << 8);
+    bool           xorRows = img[4] & DF_IMG_XORROWS;
+    uint32_t       bytes   = (w + 7) / 8;
+    const uint8_t *s       = &img[DF_IMGHDRLEN];
+
+    if ((!d->g) || (!w) || (w > DF_IMGMAXWIDTH)) { return -1; }
+
+    memset(rowBuf, 0, sizeof(rowBuf));
+
+    for (uint32_t r = 0; r < h; r++, y++) {
+        uint32_t i = 0;
+
+        while (i < bytes) {
+            int32_t n = (int8_t)*s++;
+
+            if (n >= 0) {
+                /* n+1 literal bytes */
+                if (i + ++n > bytes) { return -1; }
+                if (xorRows) {
+                    while (n--) { b[i++] ^= *s++; }
+                } else {
+                    memcpy(&b[i], s, n);
+                    i += n;
+                    s += n;
+                }
+            } else if (n != -128) {
+                /* 1-n copies of the next byte */
+                uint8_t v = *s++;
+                n         = 1 - n;
+                if (i + n > bytes) { return -1; }
+                if (!xorRows) {
+                    memset(&b[i], v, n);
+                } else if (v) {
+                    for (int32_t j = 0; j < n; j++) { b[i + j] ^= v; }
+                }
+                i += n;
+            }
+        }
+
+        if ((uint32_t)y < d->gylen) { _blitRow(_gRow(d, y), d->gxlenW, x, rowBuf, w); }
+    }
+
+    return 0;
+}
+
+/* ========================================================================== */
@@ -14,20 +14,79 @@ struct displayFile
   uint32_t xp;         /* Current cursor X position */
   uint32_t yp;         /* Current cursor Y position */   
   char *s;             /* Character storage */
+#ifdef GLYPH_CACHE
+  uint16_t *gc;        /* Glyph offset (code*DF_CHARHEIGHT) of each character, kept in step with s */
+#endif
+  uint8_t *cset;       /* RAM glyphs for codes csetFirst onwards (or NULL for none) */
+  uint32_t csetFirst;  /* First character code taken from the RAM glyphs */
+  uint32_t csetCount;  /* ...and how many codes there are */
+  uint8_t *a;          /* Attribute of each character (or NULL for none) */
+  uint32_t cursor;     /* Cursor shown at xp,yp (DF_CURSOR_xxx) */
+  uint8_t *rowMode;    /* Zoom of each text row (DF_ROW_xxx), or NULL for all normal */
 
   /* Graphic related elements */
   
   uint32_t gxstartW;   /* Start position of graphic frame in X (in terms of 32 bit words) */
+  uint32_t gxoff;      /* ...and the pixel offset within that word */
   uint32_t gystart;    /* Start position of graphic frame in Y on main screen */
   uint32_t gxlenW;     /* Length in X (in terms of 32 bit words) */
   uint32_t gylen;      /* Length in Y */
   uint32_t curX;       /* Current X position (in pixels within the window */
   uint32_t curY;       /* Current Y position (in pixels within the window */
   uint32_t *g;         /* Graphic storage (or NULL for no graphic window) */
+  uint16_t *grow;      /* Optional word offset into g of each row (or NULL for contiguous rows) */
+  uint32_t gring;      /* Ring offset, window line y is held in row (y+gring)%gylen */
+  uint32_t gcol;       /* Ring column, the window is shown starting from this storage column */
+  uint32_t pat[8];     /* Fill pattern, each row byte repeated across a word */
+  struct displayFile *layer; /* Next graphic layer, shown over this one (or NULL for none) */
+  uint32_t gop;        /* How the window is combined with what's under it (DF_OP_xxx) */
+  uint32_t gxscale;    /* Horizontal magnification on screen (1, 2 or 4) */
+  uint32_t gyscale;    /* Number of screen lines each row is repeated on */
+  struct DF_sprite *sprites; /* Sprite table (or NULL for none) */
+  uint32_t nsprites;   /* ...and number of entries in it */
+};
+
+/* Sprite, a small bitmap composited over everything else as the line is prepared. Rows are one */
+/* word each with the leftmost pixel in bit 31. Where the mask is set the sprite replaces what */
+/* is under it, elsewhere it's transparent. Moving a sprite is just a change to x and y.      */
+struct DF_sprite
+
+{
+  int16_t x;                /* Position of top left on screen, in pixels */
+  int16_t y;
+  uint16_t h;               /* Height in lines */
+  const uint32_t *bits;     /* h rows of image (or NULL to hide the sprite) */
+  const uint32_t *mask;     /* h rows of mask (or NULL to use the image as its own mask) */
 };
 
+/* Proportional font for drawing text into the graphic surface. Each glyph is trimmed to  */
+/* its inked width and its rows packed back to back into 'bits', MSB first.              */
+struct DF_font
+
+{
+  const uint8_t height;     /* Height of all glyphs (max DF_MAXFONTHEIGHT) */
+  const uint8_t spacing;    /* Blank columns between consecutive glyphs */
+  const uint8_t firstChr;   /* First character in the font */
+  const uint8_t lastChr;    /* Last character in the font */
+  const uint8_t *width;     /* Width of each glyph in pixels (max 8) */
+  const uint16_t *offset;   /* Offset of each glyph into bits, counted in bits */
+  const uint8_t *bits;      /* Packed glyph rows */
+};
+
+#define DF_MAXFONTHEIGHT (16)
+
+extern const struct DF_font font5x7;
+extern const struct DF_font font4x6;
+
 /* Utility routines for calculating storage to reserve for specified size windows */
+#ifdef GLYPH_CACHE
+/* The cache is held ahead of the characters, with a part word spare for the rasteriser to read. */
+/* It's kept in step by the DF_ writing routines, but not for text written through DF_getLine,   */
+/* which needs a DF_recache of the line afterwards.                                              */
+#define DF_SIZE(y,x) (sizeof(struct displayFile)+(((y)&&(x))?((y)*(x)+4)*sizeof(uint16_t):0)+(y)*(x))
+#else
 #define DF_SIZE(y,x) (sizeof(struct displayFile)+y*x)
+#endif
 #define DF_GSIZE(y,x)  ((y)*(x)/8)
 
 /* ============================================================================================ */
@@ -55,8 +114,56 @@ bool DF_setScr(struct displayFile *d, char c);
 int32_t DF_putChar(struct displayFile *d, uint8_t x, uint8_t y, char c);
 int32_t DF_writeString(struct displayFile *d, char *s);
 
-/* Get text line at specified index */
+/* Get text line at specified index. Writes through it bypass the glyph cache when that's */
+/* built in (WITH_GLYPH_CACHE), so call DF_recache for the line once they're done. It does */
+/* nothing otherwise. Both return NULL or -1 for a line off the screen.                   */
 char *DF_getLine(struct displayFile *d, uint8_t yp);
+int32_t DF_recache(struct displayFile *d, uint8_t yp);
+
+/* RAM character set. Codes first to first+count-1 are drawn from glyphs (DF_CHARHEIGHT */
+/* bytes per code, top row first, leftmost pixel in the MSB) instead of the ROM font, so */
+/* they can be redefined at any time for tiles, bar graphs and symbols. Rows in a       */
+/* shorter font show the top rows of each glyph.                                        */
+#define DF_CHARHEIGHT  (16)
+#define DF_CSETSIZE(n) ((n)*DF_CHARHEIGHT)
+
+void DF_setCharset(struct displayFile *d, uint8_t *glyphs, uint8_t first, uint32_t count);
+int32_t DF_defineChar(struct displayFile *d, uint8_t c, const uint8_t *rows);
+
+/* Character attributes, held in an optional plane of DF_ASIZE(yres,xres) bytes alongside  */
+/* the characters. DF_setAttrPlane clears it, DF_setAttr sets count cells from x,y on.     */
+#define DF_ATTR_INVERSE    (1<<0)
+#define DF_ATTR_UNDERLINE  (1<<1)
+#define DF_ATTR_BOLD       (1<<2)
+#define DF_ATTR_BLINK      (1<<3)
+
+#define DF_ASIZE(y,x) ((y)*(x)+3)
+
+/* Cursor drawn by the rasteriser at the current position, without touching the text */
+#define DF_CURSOR_OFF        (0)
+#define DF_CURSOR_UNDERLINE  (1)
+#define DF_CURSOR_BLOCK      (2)
+#define DF_CURSOR_BLINK      (1<<2)  /* ORed with either of the above */
+
+void DF_setCursor(struct displayFile *d, uint32_t mode);
+
+void DF_setAttrPlane(struct displayFile *d, uint8_t *a);
+int32_t DF_setAttr(struct displayFile *d, uint8_t x, uint8_t y, uint32_t count, uint8_t a);
+uint8_t *DF_getAttrLine(struct displayFile *d, uint8_t yp);
+
+/* Row modes, held in an optional array of yres bytes. A double height row shows its text  */
+/* over itself and the row below, whose own text isn't shown. A double width row shows its */
+/* first xres/2 characters. Each row can also pick its font, rows being as high as their   */
+/* fonts and following straight on from each other, so that rows of a shorter font let    */
+/* more of them onto the screen. Changes take effect from the next frame.                  */
+#define DF_ROW_NORMAL   (0)
+#define DF_ROW_DWIDTH   (1<<0)
+#define DF_ROW_DHEIGHT  (1<<1)
+#define DF_ROW_FONT(n)  ((n)<<2)  /* Font n of the rasteriser's table, 0 being the default */
+#define DF_ROW_FONTMASK (7<<2)
+
+void DF_setRowModes(struct displayFile *d, uint8_t *m);
+int32_t DF_setRowMode(struct displayFile *d, uint8_t y, uint8_t mode);
 
 /* Graphic surface routines */
 /* ======================== */
@@ -68,6 +175,10 @@ int32_t DF_setGstart( struct displayFile *d, uint32_t x, uint32_t y );
 /* Information routines */
 uint32_t *DF_getG(struct displayFile *d, uint32_t yp);
 uint32_t DF_getGXstartW(struct displayFile *d);
+uint32_t DF_getGXcol(struct displayFile *d);
+uint32_t DF_getGXoff(struct displayFile *d);
+uint32_t DF_getGop(struct displayFile *d);
+uint32_t DF_getGXscale(struct displayFile *d);
 uint32_t DF_getGXlenW(struct displayFile *d);
 uint32_t DF_getGXlen(struct displayFile *d);
 uint32_t DF_getGYlen(struct displayFile *d);
@@ -83,24 +194,128 @@ uint32_t DF_getGYlen(struct displayFile *d);
 #define LEFTLINE    64
 #define RIGHTLINE   128
 
-int32_t DF_gotoXYG(struct displayFile *d, uint32_t x, uint32_t y);
+int32_t DF_gotoXYG(struct displayFile *d, int32_t x, int32_t y);
 int32_t DF_lineTo(struct displayFile *d, int32_t h2, int32_t v2, bool fg);
 
-uint32_t DF_plotG(struct displayFile *d, uint32_t x, uint32_t y, bool isSet);
+/* Coordinates are signed and everything is clipped to the graphic window, so shapes may */
+/* lie partly (or wholly) off it.                                                        */
+uint32_t DF_plotG(struct displayFile *d, int32_t x, int32_t y, bool isSet);
 void DF_line(struct displayFile *d, int32_t h1, int32_t v1, int32_t h2, int32_t v2, bool fg);
-void DF_rect(struct displayFile *d, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t squareEdges, bool fg);
-void DF_roundRect(struct displayFile *d, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t r,
+void DF_rect(struct displayFile *d, int32_t x, int32_t y, int32_t w, int32_t h, uint32_t squareEdges, bool fg);
+void DF_roundRect(struct displayFile *d, int32_t x, int32_t y, int32_t w, int32_t h, int32_t r,
 		  uint8_t squareEdges, bool fg);
-void DF_fillRect(struct displayFile *d, uint32_t x, uint32_t y, uint32_t w, uint32_t h, bool fg);
-void DF_fillRoundRect(struct displayFile *d, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t r,
+void DF_fillRect(struct displayFile *d, int32_t x, int32_t y, int32_t w, int32_t h, bool fg);
+void DF_fillRoundRect(struct displayFile *d, int32_t x, int32_t y, int32_t w, int32_t h, int32_t r,
 		      uint8_t squareEdges, bool fg);
-void DF_circle(struct displayFile *d, uint32_t x0, uint32_t y0, uint32_t r, bool fg);
-void DF_fillCircle(struct displayFile *d, uint32_t x0, uint32_t y0, uint32_t r, bool fg);
-void DF_drawTriangle(struct displayFile *d, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, uint32_t x2,
-		     uint32_t y2, bool fg);
-void DF_fillTriangle(struct displayFile *d, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, uint32_t x2,
-		     uint32_t y2, bool fg);
+void DF_circle(struct displayFile *d, int32_t x0, int32_t y0, int32_t r, bool fg);
+void DF_fillCircle(struct displayFile *d, int32_t x0, int32_t y0, int32_t r, bool fg);
+void DF_drawTriangle(struct displayFile *d, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2,
+		     int32_t y2, bool fg);
+void DF_fillTriangle(struct displayFile *d, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2,
+		     int32_t y2, bool fg);
 void DF_clearG( struct displayFile *d, bool fg);
 
+/* Graphic layers. A layer is a displayFile with no text, made with DF_create(0, 0, s, 0) in */
+/* DF_SIZE(0, 0) bytes at s (just the struct, with or without the glyph cache) and given a    */
+/* window with DF_appendG and DF_setGstart, and all the graphic routines work on it.          */
+/* Layers are shown over the window of the main displayFile in the order they were added,  */
+/* at most DF_MAXLAYERS windows in all. Changes to the list take effect from the next frame, */
+/* so a removed layer's storage mustn't be reused until then. The lines a window covers are   */
+/* also taken at the start of the frame, so one moved with DF_setGstart during a frame may   */
+/* be cut short in that frame, but never holds up the others.                                */
+#define DF_MAXLAYERS (8)
+
+int32_t DF_addLayer(struct displayFile *d, struct displayFile *l);
+int32_t DF_removeLayer(struct displayFile *d, struct displayFile *l);
+
+/* Sprites. The table is read at the start of each frame, at most DF_MAXSPRITES of its      */
+/* entries are shown and at most DF_SPRITESPERLINE of those on any one line, later entries   */
+/* lying over earlier ones. Positions can be changed at any time, but the lines a sprite     */
+/* covers are taken at the start of the frame, so one moved up or down during a frame may be  */
+/* cut short in that frame and shows at its new place from the next.                          */
+#define DF_MAXSPRITES     (16)
+#define DF_SPRITESPERLINE (4)
+
+void DF_setSprites(struct displayFile *d, struct DF_sprite *s, uint32_t n);
+
+/* How a window is combined with the text and layers under it. Set pixels are ORed in by     */
+/* default, or inverted, cleared (so the window acts as a cutout), or the window can replace */
+/* whatever is under it outright.                                                           */
+#define DF_OP_OR    (0)
+#define DF_OP_XOR   (1)
+#define DF_OP_CLEAR (2)
+#define DF_OP_COPY  (3)
+
+void DF_setGop(struct displayFile *d, uint32_t op);
+
+/* Show a window magnified, each pixel xs (1, 2 or 4) wide and ys lines high, so a small    */
+/* window can cover a large part of the screen. Drawing is still in window pixels. A       */
+/* magnified window wider than the screen shows its leftmost part, and a ring column      */
+/* (DF_scrollGX) moves which storage column that starts from, the same as unmagnified.    */
+int32_t DF_setGscale(struct displayFile *d, uint32_t xs, uint32_t ys);
+
+/* Row indirection. With a table set, window row y is held at g[t[(y+ring)%gylen]] so rows can */
+/* share storage. DF_setGRowTable sets t up to the contiguous layout (t holds gylen entries),  */
+/* after which entries can be pointed anywhere in g. DF_scrollG moves the ring so the window  */
+/* content moves up n lines (down for -ve n), and the lines scrolled off come back in at the */
+/* other edge, ready to be redrawn. Neither moves any pixels.                                */
+void DF_setGRowTable(struct displayFile *d, uint16_t *t);
+void DF_scrollG(struct displayFile *d, int32_t n);
+
+/* Ring columns. DF_scrollGX moves the window content left n columns (right for -ve n) by    */
+/* changing the storage column the window is shown from, the rasteriser stitching the two  */
+/* halves back together. Drawing routines address storage columns, DF_colG gives the one    */
+/* shown at window column x, so a strip chart scrolls by 1 then redraws DF_colG(d, xlen-1). */
+void DF_scrollGX(struct displayFile *d, int32_t n);
+uint32_t DF_colG(struct displayFile *d, int32_t x);
+
+/* Fill pattern used by the fill routines (not the flood fill), NULL for solid. Set bits of */
+/* the 8x8 pattern take the fill colour, clear ones its inverse. It's aligned to the window.  */
+#define DF_GRAYLEVELS 9
+extern const uint8_t DF_grayPattern[DF_GRAYLEVELS][8];
+void DF_setPattern(struct displayFile *d, const uint8_t *pat);
+
+/* Polygons. DF_fillPolygon works in a caller supplied scratch area of DF_POLYSCRATCH(n) words */
+/* for n vertices and returns -1 if that's too small.                                         */
+struct DF_point
+
+{
+  int16_t x;
+  int16_t y;
+};
+
+#define DF_EVENODD  0
+#define DF_NONZERO  1
+#define DF_POLYSCRATCH(n) ((n)*(7+sizeof(void *)/sizeof(uint32_t)))
+
+void DF_polyline(struct displayFile *d, const struct DF_point *p, uint32_t n, bool fg);
+int32_t DF_fillPolygon(struct displayFile *d, const struct DF_point *p, uint32_t n, uint32_t rule, uint32_t *scratch,
+		       uint32_t scratchLen, bool fg);
+
+/* 4-connected flood fill of the region holding (x,y), with a seed stack of stackLen words from */
+/* the caller. Returns -1 if the stack ran out, in which case the fill will be incomplete.     */
+int32_t DF_floodFill(struct displayFile *d, int32_t x, int32_t y, bool fg, uint32_t *stack, uint32_t stackLen);
+
+/* Text on the graphic surface, both return the width of the string in pixels */
+int32_t DF_textWidth(const struct DF_font *f, const char *s);
+int32_t DF_drawText(struct displayFile *d, const struct DF_font *f, int32_t x, int32_t y, const char *s, bool fg);
+
+/* Ordered dither of 8 bit grayscale (0 black, 255 white) into the graphic surface, scaled up by */
+/* an integer factor. DF_ditherRow takes a single source row, so images can be streamed in a     */
+/* row at a time; output row y+n*scale comes from source row n.                                 */
+void DF_ditherRow(struct displayFile *d, const uint8_t *src, uint32_t w, int32_t x, int32_t y, uint32_t scale);
+void DF_ditherImage(struct displayFile *d, const uint8_t *src, uint32_t w, uint32_t h, uint32_t stride, int32_t x,
+		    int32_t y, uint32_t scale);
+
+/* Compressed 1bpp images as made by tools/mkimage.py. A DF_IMGHDRLEN byte header of width and */
+/* height (16 bit little endian) and flags, then each row PackBits coded, optionally as the XOR  */
+/* with the row above. DF_drawImage places the image with its top left at (x,y), clipped to the */
+/* window, and returns -1 if the image is malformed or wider than DF_IMGMAXWIDTH.              */
+#define DF_IMGHDRLEN    (5)
+#define DF_IMG_XORROWS  (1<<0)
+#define DF_IMGMAXWIDTH  (1024)
+
+int32_t DF_drawImage(struct displayFile *d, const uint8_t *img, int32_t x, int32_t y);
+
 /* ============================================================================================ */
 #endif
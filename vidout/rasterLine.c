@@ -46,51 +46,626 @@
 
 #define OPTIMISED_RASTERLINE_BITS (4)
 
+#define UNDERLINE_ROW (2)  /* Glyph row, up from the bottom, replaced for underlined characters */
+#define BLINK_SHIFT   (5)  /* Blinking toggles every 2^BLINK_SHIFT frames */
+#define CURSOR_ROW    (2)  /* Glyph rows, up from the bottom, covered by an underline cursor */
+#define MAXROWS       (48) /* Text rows that can have a mode */
+#define ROW_TOP       (1<<6) /* Top half of a double height row */
+#define ROW_BOTTOM    (1<<7) /* ...and the bottom half, on the row below it */
+
+static uint32_t _frame;    /* Frames output, for blinking */
+
+/* Graphic layers of the frame being output, sorted on their start line at the start of the frame, */
+/* and the ones covering the current line, kept in layer (z) order. The lines each one covers are   */
+/* taken then too, so a layer moved part way through a frame can't hold up the ones after it.      */
+static struct {
+    struct displayFile *sorted[DF_MAXLAYERS];
+    uint8_t             z[DF_MAXLAYERS];
+    uint32_t            start[DF_MAXLAYERS]; /* First line of each sorted layer... */
+    uint32_t            end[DF_MAXLAYERS];   /* ...and the line after its last */
+    uint32_t            nsorted;
+    uint32_t            next;   /* Next entry of sorted to become active */
+    struct displayFile *active[DF_MAXLAYERS];
+    uint8_t             az[DF_MAXLAYERS];
+    uint32_t            aend[DF_MAXLAYERS];
+    uint32_t            nactive;
+    uint32_t            line;   /* Last line rasterised */
+} _l;
+
+/* Sprites in the same way, sorted on y with up to DF_SPRITESPERLINE active, in table order */
+static struct {
+    struct DF_sprite *sorted[DF_MAXSPRITES];
+    uint8_t           idx[DF_MAXSPRITES];
+    int32_t           start[DF_MAXSPRITES];
+    int32_t           end[DF_MAXSPRITES];
+    uint32_t          nsorted;
+    uint32_t          next;
+    struct DF_sprite *active[DF_SPRITESPERLINE];
+    uint8_t           aidx[DF_SPRITESPERLINE];
+    int32_t           aend[DF_SPRITESPERLINE];
+    uint32_t          nactive;
+} _s;
+
+/* Text shown on each row and how, worked out from the row modes at the start of the frame. Row */
+/* r covers lines start[r] to start[r+1]-1, the entry after the last row is never reached.      */
+static struct {
+    const uint8_t *of;                 /* Row modes this was made from */
+    uint32_t       nrows;              /* Number of rows */
+    uint32_t       cur;                /* Row of the last line rasterised */
+    uint16_t       start[MAXROWS + 2]; /* First line of each row */
+    uint8_t        src[MAXROWS];       /* Text row shown */
+    uint8_t        mode[MAXROWS];      /* ...its zoom (DF_ROW_DWIDTH, ROW_TOP, ROW_BOTTOM) */
+    uint8_t        font[MAXROWS];      /* ...and its font */
+} _r;
+
+/* Pixel doubling of a byte, held with the first output byte in the low byte so that a pair of */
+/* them makes a line word directly.                                                           */
+#define _X2(b)                                                                                                         \
+    ((((b)&1) * 3) | (((b)&2) * 6) | (((b)&4) * 12) | (((b)&8) * 24) | (((b)&16) * 48) | (((b)&32) * 96) |                \
+     (((b)&64) * 192) | (((b)&128) * 384))
+#define _X2S(b) ((_X2(b) >> 8) | ((_X2(b) & 0xFF) << 8))
+#define _X2S4(b) _X2S(b), _X2S(b + 1), _X2S(b + 2), _X2S(b + 3)
+#define _X2S16(b) _X2S4(b), _X2S4(b + 4), _X2S4(b + 8), _X2S4(b + 12)
+#define _X2S64(b) _X2S16(b), _X2S16(b + 16), _X2S16(b + 32), _X2S16(b + 48)
+
+static const uint16_t _x2[256] = { _X2S64(0), _X2S64(64), _X2S64(128), _X2S64(192) };
+
+/* Room for a magnified window row, as much as covers the line plus the up to two storage   */
+/* words it starts in (8 words at x4), rounded to a whole number of words at either scale. */
+#define EXPANDW ((XEXTENTB / 4 + 8 + 3) & ~3)
+
+/* ============================================================================================ */
+
+void rasterFrame(struct displayFile *d, const struct rasterFont *const *f, uint32_t nf)
+
+{
+    /* Called before the start of each frame to collect the layers to be shown and sort them into
+     * start line order. This is done outside of the line interrupt's time budget. The window
+     * of d itself is layer 0, the ones chained to it follow.
+     */
+    uint32_t n = 0;
+    uint8_t  z = 0;
+
+    for (struct displayFile *l = d; (l) && (n < DF_MAXLAYERS); l = l->layer, z++) {
+        if (!l->g) { continue; }
+
+        uint32_t ys = l->gystart;
+        uint32_t i  = n++;
+        while ((i) && (_l.start[i - 1] > ys)) {
+            _l.sorted[i] = _l.sorted[i - 1];
+            _l.z[i]      = _l.z[i - 1];
+            _l.start[i]  = _l.start[i - 1];
+            _l.end[i]    = _l.end[i - 1];
+            i--;
+        }
+        _l.sorted[i] = l;
+        _l.z[i]      = z;
+        _l.start[i]  = ys;
+        _l.end[i]    = ys + l->gylen * l->gyscale;
+    }
+
+    _l.nsorted = n;
+    _l.next = _l.nactive = 0;
+    _l.line              = 0;
+    _frame++;
+
+    /* ...and the same again for the visible sprites */
+    n = 0;
+    for (uint32_t t = 0; (t < d->nsprites) && (n < DF_MAXSPRITES); t++) {
+        struct DF_sprite *sp = &d->sprites[t];
+        if ((!sp->bits) || (!sp->h)) { continue; }
+
+        int32_t  ys = sp->y;
+        uint32_t i  = n++;
+        while ((i) && (_s.start[i - 1] > ys)) {
+            _s.sorted[i] = _s.sorted[i - 1];
+            _s.idx[i]    = _s.idx[i - 1];
+            _s.start[i]  = _s.start[i - 1];
+            _s.end[i]    = _s.end[i - 1];
+            i--;
+        }
+        _s.sorted[i] = sp;
+        _s.idx[i]    = t;
+        _s.start[i]  = ys;
+        _s.end[i]    = ys + sp->h;
+    }
+
+    _s.nsorted = n;
+    _s.next = _s.nactive = 0;
+
+    /* ...and which text goes on each row and where the row starts, a double height row taking */
+    /* over the one below it.                                                                  */
+    _r.of = d->rowMode;
+    if (d->rowMode) {
+        bool     top  = false;
+        uint32_t line = 0;
+        uint32_t r;
+
+        for (r = 0; (r < d->yres) && (r < MAXROWS); r++) {
+            if (top) {
+                _r.src[r]  = r - 1;
+                _r.mode[r] = (_r.mode[r - 1] & DF_ROW_DWIDTH) | ROW_BOTTOM;
+                _r.font[r] = _r.font[r - 1];
+                top        = false;
+            } else {
+                uint32_t fi = (d->rowMode[r] & DF_ROW_FONTMASK) / DF_ROW_FONT(1);
+                _r.src[r]   = r;
+                _r.mode[r]  = d->rowMode[r] & DF_ROW_DWIDTH;
+                _r.font[r]  = (fi < nf) ? fi : 0;
+                if (d->rowMode[r] & DF_ROW_DHEIGHT) {
+                    _r.mode[r] |= ROW_TOP;
+                    top = true;
+                }
+            }
+            _r.start[r] = line;
+            line += f[_r.font[r]]->height;
+        }
+
+        _r.nrows        = r;
+        _r.start[r]     = line;
+        _r.start[r + 1] = 0xFFFF;
+        _r.cur          = 0;
+    }
+}
+
+/* ============================================================================================ */
+
+/* Combine graphic word v, already masked by m, into line word w. op is always a constant so */
+/* each use compiles down to just the one operation.                                        */
+__attribute__((always_inline)) static inline uint32_t _merge(uint32_t w, uint32_t v, uint32_t m, const uint32_t op)
+
+{
+    switch (op) {
+        case DF_OP_XOR: return w ^ v;
+        case DF_OP_CLEAR: return w & ~v;
+        case DF_OP_COPY: return (w & ~m) | v;
+        default: return w | v;
+    }
+}
+
+/* ============================================================================================ */
+
+__attribute__((always_inline)) static inline void _foldOp(uint32_t *w2, uint32_t *g, int32_t n, int32_t c, uint32_t o,
+                                                          uint32_t s, const uint32_t op)
+
+{
+    if (!(o | s)) {
+        /* Normal case, storage maps straight onto the line */
+        if (c > n) { c = n; }
+        while (c-- > 0) {
+            *w2 = _merge(*w2, *g++, 0xFFFFFFFF, op);
+            w2++;
+        }
+    } else {
+        /* Shifted case, for a ring column or a window that's not word aligned (or both). The
+         * window spans n+1 words when it starts s pixels into one, and output word k comes
+         * from storage pixel o-s+32k onwards, wrapping around the end of the storage. Each
+         * one is a funnel shift of two storage words in screen order, the first and last
+         * being masked to the window. (b>>1)>>(31-sh) avoids the undefined shift by 32.
+         */
+        int32_t   st   = (int32_t)o - (int32_t)s;
+        uint32_t  m    = 0xFFFFFFFF >> s;
+        uint32_t *gend = &g[n];
+
+        if (st < 0) { st += n << 5; }
+        if (c > n + (s != 0)) { c = n + (s != 0); }
+
+        uint32_t  sh = st & 31;
+        uint32_t *gi = &g[st >> 5];
+        uint32_t  a  = __builtin_bswap32(*gi);
+
+        for (int32_t k = 1; k <= c; k++) {
+            if (++gi == gend) { gi = g; }
+            uint32_t b = __builtin_bswap32(*gi);
+            *w2 = _merge(*w2, __builtin_bswap32(((a << sh) | ((b >> 1) >> (31 - sh))) & m), __builtin_bswap32(m), op);
+            w2++;
+            a = b;
+            m = (k == n) ? ~(0xFFFFFFFF >> s) : 0xFFFFFFFF;
+        }
+    }
+}
+
+/* ============================================================================================ */
+
+__attribute__((__section__(".ramprog"))) static inline void _fold(struct displayFile *l, uint32_t *w, int32_t words, uint32_t rl)
+
+{
+    /* Fold in the graphics of layer l for this line, limited to the part that's on the line. The
+     * composition operator is picked once here, each having its own specialised copy of the loops.
+     */
+    uint32_t *g = DF_getG(l, rl);
+    if (!g) { return; }
+
+    uint32_t *w2 = w + DF_getGXstartW(l);
+    int32_t   n  = DF_getGXlenW(l);
+    int32_t   c  = words - (int32_t)DF_getGXstartW(l);
+    uint32_t  o  = DF_getGXcol(l);
+    uint32_t  s  = DF_getGXoff(l);
+    uint32_t  xs = DF_getGXscale(l);
+    uint32_t  e[EXPANDW];
+
+    if (xs > 1) {
+        /* Magnified, so expand the row into e a byte at a time and merge that as normal. A row
+         * too wide for e is expanded from the storage word before the ring column onwards,
+         * wrapping round the ring, which is as much as the line can show. Starting a word early
+         * keeps the window's part word start clear of the end of e.
+         */
+        int32_t i;
+        int32_t k = ((int32_t)(o >> 5) + n - 1) % n;
+        if (xs == 2) {
+            for (i = 0; (i < n) && ((i + 1) * 2 <= EXPANDW); i++) {
+                uint32_t v   = g[k];
+                e[i * 2]     = _x2[v & 0xFF] | (_x2[(v >> 8) & 0xFF] << 16);
+                e[i * 2 + 1] = _x2[(v >> 16) & 0xFF] | (_x2[v >> 24] << 16);
+                if (++k == n) { k = 0; }
+            }
+        } else {
+            for (i = 0; (i < n) && ((i + 1) * 4 <= EXPANDW); i++) {
+                uint32_t v = g[k];
+                for (uint32_t b = 0; b < 4; b++, v >>= 8) {
+                    uint32_t h   = _x2[v & 0xFF];
+                    e[i * 4 + b] = _x2[h & 0xFF] | (_x2[h >> 8] << 16);
+                }
+                if (++k == n) { k = 0; }
+            }
+        }
+
+        /* ...and the ring column is now counted from the start of e */
+        o = ((o & 31) + ((n > 1) ? 32 : 0)) * xs;
+        g = e;
+        n = i * xs;
+    }
+
+    switch (DF_getGop(l)) {
+        case DF_OP_XOR: _foldOp(w2, g, n, c, o, s, DF_OP_XOR); break;
+        case DF_OP_CLEAR: _foldOp(w2, g, n, c, o, s, DF_OP_CLEAR); break;
+        case DF_OP_COPY: _foldOp(w2, g, n, c, o, s, DF_OP_COPY); break;
+        default: _foldOp(w2, g, n, c, o, s, DF_OP_OR); break;
+    }
+}
+
 /* ============================================================================================ */
 
-__attribute__((__section__(".ramprog"))) void rasterLine(struct displayFile *d, const struct rasterFont *f, uint32_t *w, uint32_t rl)
+__attribute__((__section__(".ramprog"))) static void _sprites(uint32_t *w, int32_t words, int32_t rl)
 
 {
-    /* Bit manipulation optimisation for simple division case that can be done with shifts
-     * Warning - this routine assumes that the font is 8 bits wide, if it's not then a smarter
-     * rasteriser needs to be substituted in here.
+    /* Keep the active list up to date, as for the layers, but with a limit on how many a line */
+    /* can show. A sprite that doesn't fit when it starts is left out for the rest of it. The  */
+    /* lines are the ones taken at the start of the frame, while drawing goes by the live y.  */
+    uint32_t i = 0;
+    while (i < _s.nactive) {
+        if (rl >= _s.aend[i]) {
+            for (uint32_t j = i + 1; j < _s.nactive; j++) {
+                _s.active[j - 1] = _s.active[j];
+                _s.aidx[j - 1]   = _s.aidx[j];
+                _s.aend[j - 1]   = _s.aend[j];
+            }
+            _s.nactive--;
+        } else {
+            i++;
+        }
+    }
+
+    while ((_s.next < _s.nsorted) && (_s.start[_s.next] <= rl)) {
+        uint8_t t = _s.idx[_s.next];
+        if ((_s.nactive == DF_SPRITESPERLINE) || (rl >= _s.end[_s.next])) {
+            _s.next++;
+            continue;
+        }
+
+        i = _s.nactive++;
+        while ((i) && (_s.aidx[i - 1] > t)) {
+            _s.active[i] = _s.active[i - 1];
+            _s.aidx[i]   = _s.aidx[i - 1];
+            _s.aend[i]   = _s.aend[i - 1];
+            i--;
+        }
+        _s.aend[i]   = _s.end[_s.next];
+        _s.active[i] = _s.sorted[_s.next++];
+        _s.aidx[i]   = t;
+    }
+
+    /* Each sprite row lands in at most two line words */
+    for (i = 0; i < _s.nactive; i++) {
+        struct DF_sprite *sp  = _s.active[i];
+        uint32_t          row = rl - sp->y;
+        if (row >= sp->h) { continue; }
+
+        uint32_t v  = sp->bits[row];
+        uint32_t m  = sp->mask ? sp->mask[row] : v;
+        int32_t  wx = sp->x >> 5;
+        uint32_t sh = sp->x & 31;
+
+        v &= m;
+        if ((uint32_t)wx < (uint32_t)words) {
+            w[wx] = (w[wx] & ~__builtin_bswap32(m >> sh)) | __builtin_bswap32(v >> sh);
+        }
+        if ((sh) && ((uint32_t)(wx + 1) < (uint32_t)words)) {
+            w[wx + 1] = (w[wx + 1] & ~__builtin_bswap32(m << (32 - sh))) | __builtin_bswap32(v << (32 - sh));
+        }
+    }
+}
+
+/* ============================================================================================ */
+
+__attribute__((always_inline)) static inline void _pack(struct displayFile *d, const struct rasterFont *fn, uint32_t *wp,
+                                                        const char *displayLine, uint32_t index, int32_t words,
+                                                        uint32_t zoom, const bool general)
+
+{
+    /* Text in a font narrower than 8 pixels, so characters don't fall on byte boundaries. Each
+     * glyph is the top bits of its byte and they're run together through an accumulator held in
+     * screen order, a word going out each time it fills and the part of the glyph that didn't
+     * fit starting the next one. Only whole characters are shown, the rest of the line is blank.
+     * general brings in the RAM character set, attributes and double width, the plain version
+     * being kept to the bare loop.
      */
+    const uint8_t *fd   = &fn->d[index];
+    uint32_t       ff   = fn->firstChr;
+    uint32_t       fh   = fn->height;
+    bool           wide = general && (zoom & DF_ROW_DWIDTH);
+    uint32_t       cw   = fn->width << wide;
+    int32_t        n    = d->xres;
+    uint32_t *     wend = wp + words;
+    uint32_t       acc  = 0;
+    uint32_t       bits = 0;
+
+    const uint8_t *cs = general ? d->cset : 0;
+    uint32_t       cf = d->csetFirst;
+    uint32_t       cn = cs ? d->csetCount : 0;
+    const uint8_t *al = (general && d->a) ? &d->a[displayLine - d->s] : 0;
+    bool           ul = (index == fh - UNDERLINE_ROW);
+    bool           bl = (_frame >> BLINK_SHIFT) & 1;
+    uint32_t       gm = (0xFF << (8 - fn->width)) & 0xFF;
 
-    uint32_t  *w2         = 0;
-    int c                 = 0;
-    char *    displayLine = DF_getLine(d, rl >> OPTIMISED_RASTERLINE_BITS);
-    uint32_t  index       = rl & ((1 << OPTIMISED_RASTERLINE_BITS) - 1);
+    if (n > (words * 32) / (int32_t)cw) { n = (words * 32) / (int32_t)cw; }
 
-    int32_t chrs = DF_getXres(d);
-    uint32_t *g = DF_getG(d, rl);     /* ...any graphics element to be rasterised */
-    if (g)
-      {
-	w2 = w+DF_getGXstartW(d);
-	c = DF_getGXlenW(d);
-      }
+    while (n-- > 0) {
+        uint8_t  c = *displayLine++;
+        uint32_t t;
+
+        if (!general) {
+            t = fd[(c - ff) * fh] << 24;
+        } else {
+            uint32_t g = ((uint32_t)(c - cf) < cn) ? cs[((c - cf) << OPTIMISED_RASTERLINE_BITS) + index] : fd[(c - ff) * fh];
+
+            if (al) {
+                uint32_t a = *al++;
+                if (a) {
+                    if (a & DF_ATTR_BOLD) { g |= g >> 1; }
+                    if ((a & DF_ATTR_UNDERLINE) && (ul)) { g = 0xFF; }
+                    if ((a & DF_ATTR_BLINK) && (bl)) { g = 0; }
+                    if (a & DF_ATTR_INVERSE) { g ^= 0xFF; }
+                }
+            }
+
+            g &= gm;
+            if (wide) {
+                uint32_t x = _x2[g];
+                t          = ((x << 24) | ((x & 0xFF00) << 8));
+            } else {
+                t = g << 24;
+            }
+        }
+
+        acc |= t >> bits;
+        bits += cw;
+        if (bits >= 32) {
+            *wp++ = __builtin_bswap32(acc);
+            bits -= 32;
+            acc = t << (cw - bits);
+        }
+    }
+
+    if (bits) { *wp++ = __builtin_bswap32(acc); }
+    while (wp < wend) {
+        *wp++ = 0;
+    }
+}
+
+/* ============================================================================================ */
+
+__attribute__((__section__(".ramprog"))) void rasterLine(struct displayFile *d, const struct rasterFont *const *f, uint32_t *w,
+                                                         uint32_t rl)
+
+{
+    /* Bit manipulation optimisation for simple division case that can be done with shifts.
+     * Fonts 8 bits wide put each glyph row in a byte of its own and take the fast paths below.
+     * Narrower ones (width < 8) go to _pack, which runs the glyphs together bit by bit. Nothing
+     * wider than 8 is handled.
+     */
+
+    const struct rasterFont *fn    = f[0];
+    uint32_t                 row   = rl >> OPTIMISED_RASTERLINE_BITS;
+    uint32_t                 index = rl & ((1 << OPTIMISED_RASTERLINE_BITS) - 1);
+    uint32_t                 zoom  = 0;
+    uint32_t *               wp    = w;
+
+    if ((d->rowMode) && (d->rowMode == _r.of)) {
+        /* Rows have their own fonts so they start wherever the table says. Lines come in order, */
+        /* so the row only has to be stepped on as each one finishes rather than divided out.  */
+        if (rl < _r.start[_r.cur]) { _r.cur = 0; }
+        while (rl >= _r.start[_r.cur + 1]) { _r.cur++; }
+
+        row   = _r.cur;
+        index = rl - _r.start[row];
+
+        /* Below the last row there's no text at all (and the same without modes, further down) */
+        if (row < _r.nrows) {
+            /* A zoomed row may show the text of the one above, and double height takes each glyph row twice */
+            fn   = f[_r.font[row]];
+            zoom = _r.mode[row];
+            if (zoom & ROW_TOP) {
+                index >>= 1;
+            } else if (zoom & ROW_BOTTOM) {
+                index = (index + fn->height) >> 1;
+            }
+            row = _r.src[row];
+        } else {
+            fn = 0;
+        }
+    } else if (row >= d->yres) {
+        fn = 0;
+    }
+
+    char *displayLine = DF_getLine(d, row);
+
+    int32_t chrs  = DF_getXres(d);
+    int32_t words = (chrs + 3) / 4;
+
+    /* Characters beyond the end of the line buffer can't be seen, narrow ones take fewer words */
+    if (words > XEXTENTB / 4) {
+        words = XEXTENTB / 4;
+        chrs  = words * 4;
+    }
 
     /* This could overrun, but we make it a constraint in the definition that the buffer has to be word aligned */
-    while (chrs > 0) {
-        *w   = ((f->d[((displayLine[3] - f->firstChr) << OPTIMISED_RASTERLINE_BITS) + index]) << 24) |
-               ((f->d[((displayLine[2] - f->firstChr) << OPTIMISED_RASTERLINE_BITS) + index]) << 16) |
-               ((f->d[((displayLine[1] - f->firstChr) << OPTIMISED_RASTERLINE_BITS) + index]) << 8) |
-               ((f->d[((displayLine[0] - f->firstChr) << OPTIMISED_RASTERLINE_BITS) + index]));
-	if ((g) && (w>=w2) && (c))
-	  {
-	    /* Fold in the graphics */
-	    *w |= *g++;
-	    c--;
-	  }
+    if (!fn) {
+        while (chrs > 0) {
+            *wp++ = 0;
+            chrs -= 4;
+        }
+    } else if (fn->width < 8) {
+        if (!(d->cset || d->a || zoom)) {
+            _pack(d, fn, wp, displayLine, index, words, zoom, false);
+        } else {
+            _pack(d, fn, wp, displayLine, index, words, zoom, true);
+        }
+    } else if (!(d->cset || d->a || zoom || (fn->height != (1 << OPTIMISED_RASTERLINE_BITS)))) {
+#ifdef GLYPH_CACHE
+        /* Each character's glyph offset is already to hand, so it's just a load and an indexed load */
+        const uint16_t *gc = &d->gc[displayLine - d->s];
+        const uint8_t * fd = &fn->d[index] - (fn->firstChr << OPTIMISED_RASTERLINE_BITS);
 
-#ifdef MONITOR_OUTPUT
-	/* Send this to the monitor if appropriate */
-	ITM_Send32(LCD_DATA_CHANNEL,*w);
+        while (chrs > 0) {
+            *wp++ = (fd[gc[3]] << 24) | (fd[gc[2]] << 16) | (fd[gc[1]] << 8) | (fd[gc[0]]);
+            gc += 4;
+            chrs -= 4;
+        }
+#else
+        while (chrs > 0) {
+            *wp++ = ((fn->d[((displayLine[3] - fn->firstChr) << OPTIMISED_RASTERLINE_BITS) + index]) << 24) |
+                    ((fn->d[((displayLine[2] - fn->firstChr) << OPTIMISED_RASTERLINE_BITS) + index]) << 16) |
+                    ((fn->d[((displayLine[1] - fn->firstChr) << OPTIMISED_RASTERLINE_BITS) + index]) << 8) |
+                    ((fn->d[((displayLine[0] - fn->firstChr) << OPTIMISED_RASTERLINE_BITS) + index]));
+            displayLine += 4;
+            chrs -= 4;
+        }
 #endif
+    } else {
+        /* Some codes come from the RAM character set, picked per character with a select, and/or
+         * there are attributes. Those are applied to four characters at a time, each attribute bit
+         * being spread into a byte mask with a multiply. Words with no attributes cost one test.
+         * On a double width row each glyph byte is then doubled up through the expansion table,
+         * four characters making two words. Fonts of other heights come this way too, with a
+         * multiply in place of the shift.
+         */
+        const uint8_t *cs   = d->cset;
+        uint32_t       cf   = d->csetFirst;
+        uint32_t       cn   = cs ? d->csetCount : 0;
+        const uint8_t *fd   = &fn->d[index];
+        uint32_t       ff   = fn->firstChr;
+        uint32_t       fh   = fn->height;
+        const uint8_t *al   = d->a ? &d->a[displayLine - d->s] : 0;
+        uint32_t       ul   = (index == fh - UNDERLINE_ROW) ? 0xFFFFFFFF : 0;
+        uint32_t       bl   = ((_frame >> BLINK_SHIFT) & 1) ? 0xFFFFFFFF : 0;
+        bool           wide = (zoom & DF_ROW_DWIDTH) != 0;
+
+#define _GLYPH(c)                                                                                                      \
+    ((((uint8_t)(c) - cf) < cn) ? cs[(((uint8_t)(c) - cf) << OPTIMISED_RASTERLINE_BITS) + index] : fd[((c) - ff) * fh])
+
+        while (chrs > 0) {
+            uint32_t v = (_GLYPH(displayLine[3]) << 24) | (_GLYPH(displayLine[2]) << 16) |
+                         (_GLYPH(displayLine[1]) << 8) | (_GLYPH(displayLine[0]));
+
+            if (al) {
+                uint32_t a;
+                __builtin_memcpy(&a, al, 4);
+                if (a) {
+                    v |= (v >> 1) & 0x7F7F7F7F & (((a >> 2) & 0x01010101) * 0xFF); /* Bold */
+                    v |= ul & ((a >> 1) & 0x01010101) * 0xFF;                       /* Underline */
+                    v &= ~(bl & ((a >> 3) & 0x01010101) * 0xFF);                    /* Blink */
+                    v ^= (a & 0x01010101) * 0xFF;                                   /* Inverse */
+                }
+                al += 4;
+            }
+
+            if (wide) {
+                *wp++ = _x2[v & 0xFF] | (_x2[(v >> 8) & 0xFF] << 16);
+                if (chrs > 4) { *wp++ = _x2[(v >> 16) & 0xFF] | (_x2[v >> 24] << 16); }
+                chrs -= 8;
+            } else {
+                *wp++ = v;
+                chrs -= 4;
+            }
+            displayLine += 4;
+        }
+#undef _GLYPH
+    }
+
+    /* The cursor is an XOR over its character cell on the lines it covers. In a narrow font the */
+    /* cell can straddle two words.                                                              */
+    if ((d->cursor & 3) && (fn) && (row == d->yp) &&
+        ((index + CURSOR_ROW >= (uint32_t)fn->height) || ((d->cursor & 3) == DF_CURSOR_BLOCK)) &&
+        (!((d->cursor & DF_CURSOR_BLINK) && ((_frame >> BLINK_SHIFT) & 1)))) {
+        uint32_t cw  = fn->width << ((zoom & DF_ROW_DWIDTH) != 0);
+        uint32_t pos = d->xp * cw;
+        uint32_t sh  = pos & 31;
+
+        if ((d->xp < d->xres) && (pos + cw <= (uint32_t)words * 32)) {
+            w[pos >> 5] ^= __builtin_bswap32((0xFFFFFFFF << (32 - cw)) >> sh);
+            if (sh + cw > 32) { w[(pos >> 5) + 1] ^= __builtin_bswap32(0xFFFFFFFF << (64 - sh - cw)); }
+        }
+    }
+
+    /* Lines are asked for in order through the frame, so a step backwards means a new pass */
+    if (rl < _l.line) { _l.next = _l.nactive = _s.next = _s.nactive = 0; }
+    _l.line = rl;
+
+    /* Retire layers that have finished... */
+    uint32_t i = 0;
+    while (i < _l.nactive) {
+        if (rl >= _l.aend[i]) {
+            for (uint32_t j = i + 1; j < _l.nactive; j++) {
+                _l.active[j - 1] = _l.active[j];
+                _l.az[j - 1]     = _l.az[j];
+                _l.aend[j - 1]   = _l.aend[j];
+            }
+            _l.nactive--;
+        } else {
+            i++;
+        }
+    }
 
-	w++;
-        displayLine += 4;
-        chrs -= 4;
+    /* ...take on any that start here, keeping them in layer order... */
+    while ((_l.next < _l.nsorted) && (_l.start[_l.next] <= rl)) {
+        uint8_t z = _l.z[_l.next];
+        i         = _l.nactive++;
+        while ((i) && (_l.az[i - 1] > z)) {
+            _l.active[i] = _l.active[i - 1];
+            _l.az[i]     = _l.az[i - 1];
+            _l.aend[i]   = _l.aend[i - 1];
+            i--;
+        }
+        _l.aend[i]   = _l.end[_l.next];
+        _l.active[i] = _l.sorted[_l.next++];
+        _l.az[i]     = z;
     }
+
+    /* ...and fold in the graphics of the ones covering this line, bottom layer first */
+    for (i = 0; i < _l.nactive; i++) {
+        _fold(_l.active[i], w, words, rl);
+    }
+
+    /* Sprites go over the top of everything */
+    if (_s.nactive | (_s.next < _s.nsorted)) { _sprites(w, words, rl); }
+
+#ifdef MONITOR_OUTPUT
+    /* Send this to the monitor if appropriate */
+    for (int32_t t = 0; t < words; t++) {
+        ITM_Send32(LCD_DATA_CHANNEL, w[t]);
+    }
+#endif
 }
 
 /* ============================================================================================ */
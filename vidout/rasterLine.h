@@ -13,12 +13,15 @@ struct rasterFont
 
   const uint8_t firstChr;
   const uint8_t lastChr;  
-  const uint8_t *d;
+  const uint8_t *d;       /* Glyphs narrower than 8 are the top bits of each byte, the rest clear */
 };
 
 /* ============================================================================================ */
 
-void rasterLine(struct displayFile *d, const struct rasterFont *f, uint32_t *w, uint32_t rl);
+/* f is a table of nf fonts, at most 16 lines high, picked per row with DF_ROW_FONT(). The */
+/* first is used for rows without a mode and must be 16 lines high.                        */
+void rasterFrame(struct displayFile *d, const struct rasterFont *const *f, uint32_t nf);
+void rasterLine(struct displayFile *d, const struct rasterFont *const *f, uint32_t *w, uint32_t rl);
 
 /* ============================================================================================ */
 
@@ -58,7 +58,13 @@
 #include "orblcd_protocol.h"
 #endif
 
-#include "font-8x16basic.cinc" /* The font to use */
+#include "font-8x16basic.cinc" /* The fonts to use, in VID_FONT_xxx order */
+#include "font-8x12.cinc"
+#include "font-8x8.cinc"
+#include "font-6x8.cinc"
+#include "font-5x8.cinc"
+
+static const struct rasterFont *const _fonts[] = { &font, &font8x12, &font8x8, &font6x8, &font5x8 };
 
 /* Setup materials section */
 /* ======================= */
@@ -81,11 +87,18 @@
 #define DMA_CHANNEL_IRQn DMA1_Channel3_IRQn
 #define DMA_CHANNEL_IRQHandler DMA1_Channel3_IRQHandler
 
+#ifdef RASTER_TIMING
+/* DWT cycle counter, not covered by the CMSIS version in use here */
+#define DBG_DEMCR  (*(volatile uint32_t *)0xE000EDFC)
+#define DWT_CTRL   (*(volatile uint32_t *)0xE0001000)
+#define DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)
+#endif
+
 /* Screen definition section */
 /* ========================= */
 
 /* What the screen looks like */
-#define YEXTENT (YSIZE * FONTHEIGHT * (YSTRETCH + 1)) /* How much raster we need to display all of Y */
+#define YEXTENT (VID_LINES * (YSTRETCH + 1)) /* How much raster we need to display all of Y */
 
 /* Display protocol material */
 /* ========================= */
@@ -107,20 +120,28 @@
 /* ============== */
 
 /* Definition of the screen ... done here to avoid it going on the stack */
-char storage[DF_SIZE(YSIZE, XSIZE)];
+char storage[DF_SIZE(TEXTROWS, TEXTCOLS)];
 
 /* Material related to this instance */
 /* ================================= */
 
 static volatile struct videoMachine {
-    const struct rasterFont *f;     /* the font in use */
+    const struct rasterFont *const *f; /* the fonts in use */
     struct displayFile *     d;     /* The display file being output */
     uint8_t  lineBuff[2][XEXTENTB]; /* Line buffer containing the constructed raster for output (roundup to word) */
     uint32_t scanLine;              /* The current line being scanned on the screen */
     uint32_t stretchLine;           /* Counter for line stretching */
     int32_t  opLine;                /* Line of frame being output */
     uint32_t readLine;              /* Line currently being written/read from */
-} _v = { .f = &font };
+    struct displayFile *fb;         /* Framebuffer being output directly, if any */
+    struct displayFile *fbReq;      /* ...and the one to change to at the start of the next frame */
+    uint32_t fbLine;                /* Line of the framebuffer being output */
+    const void *fbNext;             /* ...and where the DMA will take the next line from */
+#ifdef RASTER_TIMING
+    struct vidRasterTiming t;       /* Timing being accumulated for this frame */
+    struct vidRasterTiming tl;      /* ...and for the last complete one */
+#endif
+} _v = { .f = _fonts };
 
 /* If you are building without the Standard Perhiperal Library (the best way) then these are */
 /* undefined, so we define them here to avoid needing two separate builds.                   */
@@ -164,6 +185,12 @@ __attribute__((__section__(".ramprog"))) void TIM_IRQHandler(void)
     case FRAME_START ... FRAME_BACKPORCH - 1:
         /* Start of frame - create sync pulse */
         VSYNC_HIGH;
+
+        /* Without the line interrupt the blanking line has to be cleared here */
+        if (_v.fb) {
+            for (uint32_t t = 0; t < XSIZE; t++)
+                _v.lineBuff[1][t] = 0;
+        }
         break;
 
         /* ------------------------------------------------------------------------ */
@@ -171,6 +198,11 @@ __attribute__((__section__(".ramprog"))) void TIM_IRQHandler(void)
         /* Sync pulse done - top blanking */
         VSYNC_LOW;
         _v.stretchLine = _v.opLine = _v.readLine = 0;
+        _v.fb = _v.fbReq;
+        if (_v.fb) {
+            _v.fbLine = 0;
+            _v.fbNext = DF_getG(_v.fb, 0);
+        }
 
         /* Send out a zeroed line... this is in the first lineBuff at the moment */
         DMA_CHANNEL->CMAR  = (uint32_t)_v.lineBuff[1];
@@ -180,6 +212,20 @@ __attribute__((__section__(".ramprog"))) void TIM_IRQHandler(void)
 
         /* ------------------------------------------------------------------------ */
     case FRAME_OUTPUT_START ... FRAME_OUTPUT_END:
+        if (_v.fb) {
+            /* Framebuffer mode, the DMA goes straight from the row. No line interrupt is needed */
+            DMA_CHANNEL->CMAR  = (uint32_t)(_v.fbNext ? _v.fbNext : _v.lineBuff[1]);
+            DMA_CHANNEL->CNDTR = XSIZE;
+            DMA_CHANNEL->CCR |= DMA_CCR3_EN; /* Enable, No TCIE */
+
+            /* Work out the next row now, so it doesn't add jitter to the start of the line */
+            if (_v.stretchLine++ == YSTRETCH) {
+                _v.stretchLine = 0;
+                _v.fbNext      = DF_getG(_v.fb, ++_v.fbLine);
+            }
+            break;
+        }
+
         /* Set the previusly prepared scanLine ready to be output */
         DMA_CHANNEL->CMAR  = (uint32_t)_v.lineBuff[_v.readLine];
         DMA_CHANNEL->CNDTR = XSIZE;
@@ -225,17 +271,25 @@ __attribute__((__section__(".ramprog"))) void DMA_CHANNEL_IRQHandler(void)
 
     DMA->IFCR = DMA1_IT_TC3;
 
-    if (_v.opLine >= YSIZE * FONTHEIGHT) {
+    if (_v.opLine >= VID_LINES) {
         /* No more valid scan lines in this frame, so don't output more video */
         /* ...and make sure the first line is set up to go out */
+        rasterFrame(_v.d, _v.f, sizeof(_fonts) / sizeof(_fonts[0]));
         rasterLine(_v.d, _v.f, (uint32_t *)_v.lineBuff[0], 0);
         _v.readLine = 0;
 
+#ifdef RASTER_TIMING
+        if (_v.t.lines) {
+            _v.tl = _v.t;
+            _v.t.lines = _v.t.total = _v.t.max = 0;
+        }
+#endif
+
 #ifdef MONITOR_OUTPUT
-	if (_v.opLine == YSIZE * FONTHEIGHT)
+	if (_v.opLine == VID_LINES)
 	  {
 	    /* This is sent at the start of every frame in case the other end wasn't awake */
-	    ITM_Send32(LCD_COMMAND_CHANNEL,ORBLCD_OPEN_SCREEN(XSIZE*8,YSIZE*16,ORBLCD_DEPTH_1));
+	    ITM_Send32(LCD_COMMAND_CHANNEL,ORBLCD_OPEN_SCREEN(XSIZE*8,VID_LINES,ORBLCD_DEPTH_1));
 	  }
 #endif
 
@@ -244,7 +298,16 @@ __attribute__((__section__(".ramprog"))) void DMA_CHANNEL_IRQHandler(void)
             _v.lineBuff[1][t] = 0;
     } else {
         /* Prepare next line for output */
+#ifdef RASTER_TIMING
+        uint32_t c = DWT_CYCCNT;
+#endif
         rasterLine(_v.d, _v.f, (uint32_t *)_v.lineBuff[!_v.readLine], _v.opLine++);
+#ifdef RASTER_TIMING
+        c = DWT_CYCCNT - c;
+        _v.t.lines++;
+        _v.t.total += c;
+        if (c > _v.t.max) { _v.t.max = c; }
+#endif
     }
 }
 
@@ -256,7 +319,7 @@ __attribute__((__section__(".ramprog"))) void DMA_CHANNEL_IRQHandler(void)
 /* ============================================================================================ */
 /* ============================================================================================ */
 
-uint32_t vidxSizeG(void) { return YSIZE * FONTHEIGHT; }
+uint32_t vidxSizeG(void) { return VID_LINES; }
 
 /* ============================================================================================ */
 
@@ -264,6 +327,40 @@ uint32_t vidySizeG(void) { return XSIZE * FONTWIDTH; }
 
 /* ============================================================================================ */
 
+int32_t vidFramebuffer(struct displayFile *fb)
+
+{
+    /* The DMA reads rows straight from the window, so they have to be wide enough */
+    if (fb) {
+        if ((!fb->g) || (DF_getGXlen(fb) < VID_FBWIDTH)) { return -1; }
+        DF_setGstart(fb, 0, 0);
+    } else if (_v.fb) {
+        /* The line interrupt hasn't run while the framebuffer was out, so set up the first line */
+        /* as it would have done at the end of the frame. Only lineBuff[1] is in use until the   */
+        /* change is made, and that's at the start of a frame, so this can't be seen half done.  */
+        rasterFrame(_v.d, _v.f, sizeof(_fonts) / sizeof(_fonts[0]));
+        rasterLine(_v.d, _v.f, (uint32_t *)_v.lineBuff[0], 0);
+    }
+
+    _v.fbReq = fb;
+    return 0;
+}
+
+/* ============================================================================================ */
+
+#ifdef RASTER_TIMING
+void vidGetRasterTiming(struct vidRasterTiming *t)
+
+{
+    /* Copy with the line interrupt held off so the three values belong to the same frame */
+    NVIC_DisableIRQ(DMA_CHANNEL_IRQn);
+    *t = _v.tl;
+    NVIC_EnableIRQ(DMA_CHANNEL_IRQn);
+}
+#endif
+
+/* ============================================================================================ */
+
 struct displayFile *vidInit(void)
 
 {
@@ -273,12 +370,19 @@ struct displayFile *vidInit(void)
     RCC->APB2ENR |= RCC_APB2Periph_SPI1 | RCC_APB2Periph_TIM1 | RCC_APB2Periph_GPIOA | RCC_APB2Periph_GPIOB;
 
     SETUP_BUSY;
+
+#ifdef RASTER_TIMING
+    /* Start the cycle counter */
+    DBG_DEMCR |= (1 << 24); /* TRCENA */
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= 1; /* CYCCNTENA */
+#endif
     SETUP_VSYNC;
     SETUP_HSYNC;
     SETUP_VOUT;
 
     /* Create the video handler object */
-    _v.d = DF_create(YSIZE, XSIZE, storage, ' ');
+    _v.d = DF_create(TEXTROWS, TEXTCOLS, storage, ' ');
 
     /* Setup the DMA transfer details */
     DMA_CHANNEL->CCR  = DMA_CCR1_MINC | DMA_CCR1_DIR;
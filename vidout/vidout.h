@@ -8,6 +8,9 @@
 
 //#define HIRES                          /* Define this for high definition in X */
 #define BUSY_DEBUG                       /* Define this to enable a busy flag */
+//#define RASTER_TIMING                  /* Define this to time rasterLine with the DWT cycle counter */
+//#define TEXTROWS   36                  /* Rows of text held, if more than fit in the 8x16 font (see below) */
+//#define TEXTCOLS   80                  /* Columns of text held, if more than fit in the 8 pixel fonts */
 #define HIGHPRI_IRQ (0)                  /* This is the HSYNC interrupt and needs to be very high priority */
 #define LOWPRI_IRQ  (1)                  /* This is the line preparation (SPI) interrupt and can have a */
                                          /* lower priority, but you may have to raise it if you see corruption. */
@@ -27,8 +30,30 @@
 #define FRAME_YDISPLACEMENT 10
 #endif
 
+#ifndef TEXTROWS
+#define TEXTROWS   YSIZE                 /* Rows of text held, more are only seen with shorter fonts */
+#endif
+#ifndef TEXTCOLS
+#define TEXTCOLS   XSIZE                 /* Columns of text held, more are only seen with narrow fonts */
+#endif
+
 #define ROUNDUP4(x) (((x+3)/4)*4)
 #define XEXTENTB   (ROUNDUP4(XSIZE))     /* What the X resolution is in bytes */
+#define VID_LINES  (YSIZE*16)            /* Lines on the screen, YSIZE rows of the 8x16 font */
+
+/* Fonts that text rows can pick with DF_setRowMode. Rows follow on from each other, so   */
+/* 8x8 rows all the way down give 2*YSIZE of them if TEXTROWS allows it. The narrow fonts */
+/* give XSIZE*8/6 or XSIZE*8/5 columns, if TEXTCOLS allows it.                           */
+#define VID_FONT_8X16 DF_ROW_FONT(0)
+#define VID_FONT_8X12 DF_ROW_FONT(1)
+#define VID_FONT_8X8  DF_ROW_FONT(2)
+#define VID_FONT_6X8  DF_ROW_FONT(3)
+#define VID_FONT_5X8  DF_ROW_FONT(4)
+
+/* Storage needed for a full screen framebuffer */
+#define VID_FBLINES  (VID_LINES)
+#define VID_FBWIDTH  (XEXTENTB*8)
+#define VID_FBSIZE   DF_GSIZE(VID_FBLINES,VID_FBWIDTH)
 
 #ifdef BUSY_DEBUG
 #define SETUP_BUSY GPIOB->CRH=((GPIOB->CRH)&0xFFF0FFFF)|0x30000  
@@ -46,6 +71,26 @@ uint32_t vidxSizeG(void);
 uint32_t vidySizeG(void);
 struct displayFile *vidInit(void);
 
+/* Output the graphic window of fb directly instead of the text and layers, or go back to  */
+/* normal output with NULL. The window must be at least VID_FBWIDTH wide and is shown from */
+/* the top left of the screen. The row table and ring offset are followed, but not ring   */
+/* columns, X offsets or composition operators, and nothing is sent to the monitor. The   */
+/* change is made at the start of the next frame.                                         */
+int32_t vidFramebuffer(struct displayFile *fb);
+
+#ifdef RASTER_TIMING
+/* Cost of rasterLine over the last complete frame, in CPU cycles */
+struct vidRasterTiming
+
+{
+  uint32_t lines;      /* Number of lines rasterised */
+  uint32_t total;      /* Total cycles for all of them */
+  uint32_t max;        /* Cycles for the slowest one */
+};
+
+void vidGetRasterTiming(struct vidRasterTiming *t);
+#endif
+
 /* ============================================================================================ */
 #endif	/*  _VIDEO_H_ */
 